@@ -3,7 +3,13 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -19,8 +25,32 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* I/O statistics. */
+    block_sector_t next_sector;         /* Sector after last request. */
+
+    /* Request queue, for a device without a remap operation. */
+    struct lock queue_lock;             /* Protects the queue. */
+    struct condition queue_nonempty;    /* Signaled on each submit. */
+    struct list queue;                  /* Requests, by dev_sector. */
+    block_sector_t head;                /* Sector after last transfer. */
+    int in_flight;                      /* Requests queued or in progress. */
+    int dispatcher_cnt;                 /* Number of dispatcher threads. */
+    struct lock bounce_lock;            /* Protects bounce. */
+    uint8_t *bounce;                    /* Page for block_io() to fall
+                                           back on. */
   };
 
+/* Most sectors that merged requests may add up to.  Requests
+   whose buffers are not adjacent in memory are merged only up
+   to the size of the merge buffer, through which they are
+   copied. */
+#define MERGE_MAX 256
+#define MERGE_BUFFER_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Take requests in arrival order, without merging.  Set by
+   kernel command-line option "-fifo". */
+bool block_fifo;
+
 /* List of all block devices. */
 static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 
@@ -28,6 +58,24 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static struct block *queue_owner (struct block *);
+static void block_io (struct block *, bool write, block_sector_t,
+                      block_sector_t cnt, void *);
+static block_request_func wake_submitter;
+static thread_func dispatcher;
+static block_sector_t take_batch (struct block *, struct list *batch,
+                                  bool *contiguous, bool can_copy);
+static void transfer (struct block *, struct list *batch,
+                      block_sector_t cnt, bool contiguous,
+                      uint8_t *merge_buffer);
+static list_less_func request_less;
+static void account_submit (struct block *, const struct block_request *,
+                            block_sector_t sector, int depth);
+static void account_done (struct block *, const struct block_request *,
+                          int64_t latency);
+static int log2_bucket (uint64_t value, int bucket_cnt);
+static void print_xfer_stats (const char *name,
+                              const struct block_xfer_stats *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -113,6 +161,18 @@ check_sector (struct block *block, block_sector_t sector)
     }
 }
 
+/* Verifies that the CNT sectors starting at SECTOR are all
+   within BLOCK.  Panics if not. */
+static void
+check_sectors (struct block *block, block_sector_t sector,
+               block_sector_t cnt)
+{
+  ASSERT (cnt > 0);
+  check_sector (block, sector);
+  if (cnt > block->size - sector)
+    check_sector (block, block->size);
+}
+
 /* Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -120,9 +180,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  block_io (block, false, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +191,391 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  block_io (block, true, sector, 1, (void *) buffer);
+}
+
+/* Reads CNT consecutive sectors, starting at SECTOR, from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it move all of the sectors with
+   as few commands as they can, instead of one per sector.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multi (struct block *block, block_sector_t sector,
+                  block_sector_t cnt, void *buffer)
+{
+  block_io (block, false, sector, cnt, buffer);
+}
+
+/* Writes CNT consecutive sectors, starting at SECTOR, to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of the data.  Internally synchronizes accesses to block
+   devices, so external per-block device locking is unneeded. */
+void
+block_write_multi (struct block *block, block_sector_t sector,
+                   block_sector_t cnt, const void *buffer)
+{
+  block_io (block, true, sector, cnt, (void *) buffer);
+}
+
+/* Queues request R to BLOCK, or to the device that BLOCK remaps
+   onto, and returns without waiting for it to complete.  R must
+   stay allocated until its DONE function has been called, and
+   its buffer must be in kernel memory.  Must not be called from
+   an interrupt handler. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  enum intr_level old_level;
+  block_sector_t sector;
+  struct block *b;
+  int depth;
+
+  ASSERT (r->cnt > 0);
+  ASSERT (is_kernel_vaddr (r->buffer));
+  ASSERT (!r->write || block->type != BLOCK_FOREIGN);
+
+  /* Find the device that queues R. */
+  r->origin = block;
+  r->dev_sector = r->sector;
+  check_sectors (block, r->dev_sector, r->cnt);
+  while (block->ops->remap != NULL)
+    {
+      block = block->ops->remap (block->aux, &r->dev_sector);
+      check_sectors (block, r->dev_sector, r->cnt);
+    }
+
+  /* Account for R in each device it passes through. */
+  old_level = intr_disable ();
+  depth = ++block->in_flight;
+  for (b = r->origin, sector = r->sector; ;
+       b = b->ops->remap (b->aux, &sector))
+    {
+      account_submit (b, r, sector, depth);
+      if (b == block)
+        break;
+    }
+  intr_set_level (old_level);
+  r->submit_ns = timer_ns ();
+
+  lock_acquire (&block->queue_lock);
+  if (block_fifo)
+    list_push_back (&block->queue, &r->elem);
+  else
+    list_insert_ordered (&block->queue, &r->elem, request_less, NULL);
+  cond_signal (&block->queue_nonempty, &block->queue_lock);
+  lock_release (&block->queue_lock);
+}
+
+/* Transfers CNT sectors between BLOCK, starting at SECTOR, and
+   BUFFER, in the direction given by WRITE, and waits for the
+   transfer to complete.
+
+   The device's dispatcher thread cannot reach user memory,
+   because it does not run with the submitter's page directory,
+   so a user BUFFER, as file system calls pass down, is copied
+   through a kernel page one page at a time.  If no page is free,
+   the transfer waits its turn for the page that the device set
+   aside for the purpose. */
+static void
+block_io (struct block *block, bool write, block_sector_t sector,
+          block_sector_t cnt, void *buffer_)
+{
+  uint8_t *buffer = buffer_;
+  uint8_t *bounce = NULL;
+  struct block *owner = NULL;
+  struct block_request r;
+  struct semaphore done;
+
+  if (is_user_vaddr (buffer))
+    {
+      bounce = palloc_get_page (0);
+      if (bounce == NULL)
+        {
+          owner = queue_owner (block);
+          lock_acquire (&owner->bounce_lock);
+          bounce = owner->bounce;
+        }
+    }
+
+  sema_init (&done, 0);
+  r.write = write;
+  r.done = wake_submitter;
+  r.aux = &done;
+  while (cnt > 0)
+    {
+      block_sector_t n = cnt;
+
+      if (bounce != NULL && n > MERGE_BUFFER_SECTORS)
+        n = MERGE_BUFFER_SECTORS;
+      if (bounce != NULL && write)
+        memcpy (bounce, buffer, n * BLOCK_SECTOR_SIZE);
+
+      r.sector = sector;
+      r.cnt = n;
+      r.buffer = bounce != NULL ? bounce : buffer;
+      block_submit (block, &r);
+      sema_down (&done);
+
+      if (bounce != NULL && !write)
+        memcpy (buffer, bounce, n * BLOCK_SECTOR_SIZE);
+      sector += n;
+      cnt -= n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+    }
+  if (owner != NULL)
+    lock_release (&owner->bounce_lock);
+  else
+    palloc_free_page (bounce);
+}
+
+/* Completion function for block_io(). */
+static void
+wake_submitter (struct block_request *r)
+{
+  sema_up (r->aux);
+}
+
+/* Thread that carries out the requests queued to BLOCK.  A
+   device with several dispatchers has that many transfers in
+   progress at once.  A dispatcher that cannot get a page for its
+   merge buffer merges only requests whose buffers are adjacent
+   in memory. */
+static void
+dispatcher (void *block_)
+{
+  struct block *block = block_;
+  uint8_t *merge_buffer = palloc_get_page (0);
+
+  for (;;)
+    {
+      struct list batch;
+      block_sector_t cnt;
+      bool contiguous;
+
+      lock_acquire (&block->queue_lock);
+      while (list_empty (&block->queue))
+        cond_wait (&block->queue_nonempty, &block->queue_lock);
+      cnt = take_batch (block, &batch, &contiguous, merge_buffer != NULL);
+      lock_release (&block->queue_lock);
+
+      transfer (block, &batch, cnt, contiguous, merge_buffer);
+
+      /* A request's DONE function may free it, so account for
+         the request first. */
+      while (!list_empty (&batch))
+        {
+          struct block_request *r = list_entry (list_pop_front (&batch),
+                                                struct block_request, elem);
+          int64_t latency = timer_ns () - r->submit_ns;
+          enum intr_level old_level;
+          block_sector_t sector = r->sector;
+          struct block *b;
+
+          old_level = intr_disable ();
+          block->in_flight--;
+          for (b = r->origin; ; b = b->ops->remap (b->aux, &sector))
+            {
+              account_done (b, r, latency);
+              if (b == block)
+                break;
+            }
+          intr_set_level (old_level);
+
+          if (r->done != NULL)
+            r->done (r);
+        }
+    }
+}
+
+/* Moves the next request in C-LOOK order from BLOCK's queue into
+   BATCH, followed by the queued requests that merge with it.  If
+   block_fifo is true, moves just the oldest request instead.
+   Returns the number of sectors in BATCH, and sets *CONTIGUOUS
+   to whether its requests' buffers are adjacent in memory, which
+   they must be unless CAN_COPY is true.  BLOCK's queue lock must
+   be held and its queue nonempty. */
+static block_sector_t
+take_batch (struct block *block, struct list *batch, bool *contiguous,
+            bool can_copy)
+{
+  struct block_request *first, *last;
+  struct list_elem *e;
+  block_sector_t cnt;
+
+  ASSERT (!list_empty (&block->queue));
+
+  /* Continue upward from the last sector transferred, or wrap
+     around to the lowest sector. */
+  for (e = list_begin (&block->queue);
+       !block_fifo && e != list_end (&block->queue); e = list_next (e))
+    if (list_entry (e, struct block_request, elem)->dev_sector >= block->head)
+      break;
+  if (e == list_end (&block->queue))
+    e = list_begin (&block->queue);
+
+  list_init (batch);
+  first = last = list_entry (e, struct block_request, elem);
+  cnt = first->cnt;
+  *contiguous = true;
+  e = list_remove (e);
+  list_push_back (batch, &first->elem);
+
+  /* Merge the requests that follow in the same direction. */
+  while (!block_fifo && e != list_end (&block->queue))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      bool adjacent = (*contiguous
+                       && ((uint8_t *) r->buffer
+                           == (uint8_t *) last->buffer
+                              + last->cnt * BLOCK_SECTOR_SIZE));
+
+      if (r->write != first->write
+          || r->dev_sector != first->dev_sector + cnt
+          || cnt + r->cnt > MERGE_MAX
+          || (!adjacent
+              && (!can_copy || cnt + r->cnt > MERGE_BUFFER_SECTORS)))
+        break;
+
+      *contiguous = adjacent;
+      cnt += r->cnt;
+      last = r;
+      e = list_remove (e);
+      list_push_back (batch, &r->elem);
+    }
+
+  block->head = first->dev_sector + cnt;
+  return cnt;
+}
+
+/* Carries out the CNT sectors of requests in BATCH, which
+   take_batch() put together, with BLOCK's driver.  If CONTIGUOUS
+   is false, the data passes through MERGE_BUFFER, a page. */
+static void
+transfer (struct block *block, struct list *batch, block_sector_t cnt,
+          bool contiguous, uint8_t *merge_buffer)
+{
+  struct block_request *first = list_entry (list_front (batch),
+                                            struct block_request, elem);
+  block_sector_t sector = first->dev_sector;
+  uint8_t *buffer = contiguous ? first->buffer : merge_buffer;
+  struct list_elem *e;
+  size_t ofs;
+
+  if (first->write)
+    {
+      if (!contiguous)
+        for (e = list_begin (batch), ofs = 0; e != list_end (batch);
+             e = list_next (e))
+          {
+            struct block_request *r = list_entry (e, struct block_request,
+                                                  elem);
+            memcpy (buffer + ofs, r->buffer, r->cnt * BLOCK_SECTOR_SIZE);
+            ofs += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+
+      if (block->ops->write_multi != NULL)
+        block->ops->write_multi (block->aux, sector, cnt, buffer);
+      else
+        for (ofs = 0; ofs < cnt; ofs++)
+          block->ops->write (block->aux, sector + ofs,
+                             buffer + ofs * BLOCK_SECTOR_SIZE);
+    }
+  else
+    {
+      if (block->ops->read_multi != NULL)
+        block->ops->read_multi (block->aux, sector, cnt, buffer);
+      else
+        for (ofs = 0; ofs < cnt; ofs++)
+          block->ops->read (block->aux, sector + ofs,
+                            buffer + ofs * BLOCK_SECTOR_SIZE);
+
+      if (!contiguous)
+        for (e = list_begin (batch), ofs = 0; e != list_end (batch);
+             e = list_next (e))
+          {
+            struct block_request *r = list_entry (e, struct block_request,
+                                                  elem);
+            memcpy (r->buffer, buffer + ofs, r->cnt * BLOCK_SECTOR_SIZE);
+            ofs += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+    }
+}
+
+/* Adds request R, which starts at SECTOR within BLOCK, to
+   BLOCK's statistics as it is submitted.  DEPTH is the queue
+   depth that R sees.  Interrupts must be off. */
+static void
+account_submit (struct block *block, const struct block_request *r,
+                block_sector_t sector, int depth)
+{
+  struct block_xfer_stats *x = r->write ? &block->stats.write
+                                        : &block->stats.read;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (r->write)
+    block->write_cnt += r->cnt;
+  else
+    block->read_cnt += r->cnt;
+
+  if (sector == block->next_sector)
+    x->sequential++;
+  else
+    x->random++;
+  block->next_sector = sector + r->cnt;
+
+  block->stats.depth[log2_bucket (depth, BLOCK_DEPTH_BUCKETS)]++;
+  block->stats.depth_total += depth;
+  if ((uint32_t) depth > block->stats.depth_max)
+    block->stats.depth_max = depth;
+}
+
+/* Adds completed request R, which took LATENCY nanoseconds, to
+   BLOCK's statistics.  Interrupts must be off. */
+static void
+account_done (struct block *block, const struct block_request *r,
+              int64_t latency)
+{
+  struct block_xfer_stats *x = r->write ? &block->stats.write
+                                        : &block->stats.read;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  x->requests++;
+  x->bytes += (uint64_t) r->cnt * BLOCK_SECTOR_SIZE;
+  x->total_ns += latency;
+  x->latency[log2_bucket (latency / 1000, BLOCK_LATENCY_BUCKETS)]++;
+}
+
+/* Returns the histogram bucket for VALUE: 0 for values less
+   than 2, otherwise the base-2 logarithm of VALUE, but no more
+   than BUCKET_CNT - 1. */
+static int
+log2_bucket (uint64_t value, int bucket_cnt)
+{
+  int bucket = 0;
+
+  while (value >= 2 && bucket < bucket_cnt - 1)
+    {
+      value >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Orders requests by the sector at which they start. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request,
+                                              elem);
+  const struct block_request *b = list_entry (b_, struct block_request,
+                                              elem);
+
+  return a->dev_sector < b->dev_sector;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,24 +599,78 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Copies BLOCK's I/O statistics into *STATS. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = block->stats;
+  intr_set_level (old_level);
+  strlcpy (stats->name, block->name, sizeof stats->name);
+}
+
+/* Prints statistics for each block device that is used for a
+   Pintos role or has done any I/O. */
 void
 block_print_stats (void)
 {
-  int i;
+  struct list_elem *e;
 
-  for (i = 0; i < BLOCK_ROLE_CNT; i++)
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
     {
-      struct block *block = block_by_role[i];
-      if (block != NULL)
+      struct block *block = list_entry (e, struct block, list_elem);
+      const struct block_stats *stats = &block->stats;
+      uint64_t samples = stats->read.sequential + stats->read.random
+                         + stats->write.sequential + stats->write.random;
+      bool has_role = (block->type < BLOCK_ROLE_CNT
+                       && block_by_role[block->type] == block);
+
+      if (!has_role && samples == 0)
+        continue;
+
+      printf ("%s (%s): %llu reads, %llu writes\n",
+              block->name, block_type_name (block->type),
+              block->read_cnt, block->write_cnt);
+      print_xfer_stats ("read", &stats->read);
+      print_xfer_stats ("write", &stats->write);
+      if (samples > 0)
         {
-          printf ("%s (%s): %llu reads, %llu writes\n",
-                  block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+          unsigned long long avg_x100 = stats->depth_total * 100 / samples;
+          printf ("  queue depth: avg %llu.%02llu, max %"PRIu32"\n",
+                  avg_x100 / 100, avg_x100 % 100, stats->depth_max);
         }
     }
 }
 
+/* Prints the statistics X for transfers in direction NAME, if
+   there were any. */
+static void
+print_xfer_stats (const char *name, const struct block_xfer_stats *x)
+{
+  int i;
+
+  if (x->requests == 0)
+    return;
+
+  printf ("  %ss: %llu requests, %llu bytes, %llu sequential, "
+          "%llu random, avg %llu us\n",
+          name, (unsigned long long) x->requests,
+          (unsigned long long) x->bytes,
+          (unsigned long long) x->sequential,
+          (unsigned long long) x->random,
+          (unsigned long long) (x->total_ns / x->requests / 1000));
+  if (x->commands != 0)
+    printf ("  %s commands: %llu\n", name,
+            (unsigned long long) x->commands);
+  printf ("  %s latency (us, count):", name);
+  for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+    if (x->latency[i] != 0)
+      printf (" %s%llu:%"PRIu32, i == BLOCK_LATENCY_BUCKETS - 1 ? ">=" : "",
+              i == 0 ? 0 : 1ULL << i, x->latency[i]);
+  printf ("\n");
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -200,6 +693,25 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->next_sector = 0;
+
+  /* A device that remaps its requests onto another device needs
+     no queue of its own. */
+  if (ops->remap == NULL)
+    {
+      lock_init (&block->queue_lock);
+      cond_init (&block->queue_nonempty);
+      list_init (&block->queue);
+      block->head = 0;
+      block->in_flight = 0;
+      block->dispatcher_cnt = 0;
+      lock_init (&block->bounce_lock);
+      block->bounce = palloc_get_page (0);
+      if (block->bounce == NULL)
+        PANIC ("Failed to allocate bounce page for block device");
+      block_set_queue_depth (block, 1);
+    }
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -211,6 +723,47 @@ block_register (const char *name, enum block_type type,
   return block;
 }
 
+/* Gives BLOCK enough dispatcher threads to keep DEPTH requests
+   in progress at once, for a driver whose operations may be
+   called that many times concurrently.  The number of
+   dispatchers never decreases. */
+void
+block_set_queue_depth (struct block *block, int depth)
+{
+  ASSERT (block->ops->remap == NULL);
+  ASSERT (depth > 0);
+
+  for (; block->dispatcher_cnt < depth; block->dispatcher_cnt++)
+    thread_create (block->name, PRI_MAX, dispatcher, block);
+}
+
+/* Counts one command that BLOCK's driver has issued to the
+   device for a transfer in the direction given by WRITE.  A
+   driver that calls this lets the statistics show how many
+   commands its transfers take. */
+void
+block_count_command (struct block *block, bool write)
+{
+  enum intr_level old_level = intr_disable ();
+  if (write)
+    block->stats.write.commands++;
+  else
+    block->stats.read.commands++;
+  intr_set_level (old_level);
+}
+
+/* Returns the device that queues BLOCK's requests: BLOCK itself,
+   or the device that it remaps onto, directly or indirectly. */
+static struct block *
+queue_owner (struct block *block)
+{
+  block_sector_t sector = 0;
+
+  while (block->ops->remap != NULL)
+    block = block->ops->remap (block->aux, &sector);
+  return block;
+}
+
 /* Returns the block device corresponding to LIST_ELEM, or a null
    pointer if LIST_ELEM is the list end of all_blocks. */
 static struct block *
@@ -1,8 +1,11 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
+#include <stats.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,10 +56,60 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multi (struct block *, block_sector_t, block_sector_t cnt,
+                       void *);
+void block_write_multi (struct block *, block_sector_t, block_sector_t cnt,
+                        const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests.
+
+   block_submit() queues a request and returns at once.  Each
+   device has a thread that takes requests from its queue in
+   C-LOOK order, that is, in increasing sector order from the
+   last sector transferred, wrapping around to the lowest sector
+   after the highest, or several such threads if its driver can
+   keep that many requests in progress at once.  Requests in the
+   same direction for adjacent sectors are merged into a single
+   transfer.  When a request completes, its DONE function, if
+   any, is called in one of the device's threads, which it must
+   not block waiting for more I/O on the same device.
+
+   Requests that overlap are not ordered with respect to each
+   other: a caller that needs one to complete before another must
+   wait for it.  block_read(), block_write(), block_read_multi(),
+   and block_write_multi() submit a request and wait for it. */
+struct block_request;
+typedef void block_request_func (struct block_request *);
+
+struct block_request
+  {
+    /* Filled in by the submitter. */
+    bool write;                 /* Write, rather than read? */
+    block_sector_t sector;      /* First sector. */
+    block_sector_t cnt;         /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes, in
+                                   kernel memory. */
+    block_request_func *done;   /* Called on completion, if non-null. */
+    void *aux;                  /* For use by DONE. */
+
+    /* Owned by the block layer while the request is queued. */
+    struct list_elem elem;      /* Element in device's queue. */
+    block_sector_t dev_sector;  /* SECTOR on the queuing device. */
+    struct block *origin;       /* Device submitted to. */
+    int64_t submit_ns;          /* Time of submission, from timer_ns(). */
+  };
+
+/* Take requests in arrival order and never merge them, enabled
+   by kernel command-line option "-fifo", to measure what the
+   elevator gains. */
+extern bool block_fifo;
+
+void block_submit (struct block *, struct block_request *);
+
 /* Statistics. */
+void block_get_stats (struct block *, struct block_stats *);
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
@@ -65,10 +118,26 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Transfer CNT consecutive sectors.  Optional: if null, the
+       block layer calls read or write once per sector. */
+    void (*read_multi) (void *aux, block_sector_t, block_sector_t cnt,
+                        void *buffer);
+    void (*write_multi) (void *aux, block_sector_t, block_sector_t cnt,
+                         const void *buffer);
+
+    /* For a device that is a window onto another, such as a
+       partition.  Optional: if non-null, the block layer sends
+       requests to the device it returns, with *SECTOR translated
+       into that device's sectors, and the operations above
+       may be null. */
+    struct block *(*remap) (void *aux, block_sector_t *sector);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_set_queue_depth (struct block *, int depth);
+void block_count_command (struct block *, bool write);
 
 #endif /* devices/block.h */
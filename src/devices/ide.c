@@ -3,15 +3,33 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If the IDE controller is a PCI bus master, such as the PIIX
+   IDE function that QEMU and most PCs of the ATA era provide,
+   sectors are transferred by bus-master DMA, as described in
+   "Programming Interface for Bus Master IDE Controller",
+   revision 1.0.  The CPU then only sets up each transfer and
+   waits for its completion interrupt, instead of copying every
+   byte through the data register.  Otherwise, or if a disk does
+   not support DMA, sectors are transferred with programmed I/O
+   (PIO). */
+
+/* Use PIO even if DMA is available.  Set by kernel command-line
+   option "-pio". */
+bool ide_pio;
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -34,6 +52,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +68,64 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* IDENTIFY DEVICE words. */
+#define ID_MAX_MULTIPLE 47              /* Low byte: READ/WRITE MULTIPLE
+                                           sectors per block, at most. */
+#define ID_CAPABILITIES 49              /* Capabilities. */
+#define ID_CAP_DMA 0x0100               /* DMA supported. */
+
+/* Bus master IDE register port addresses.  Each channel has its
+   own set of registers, at offset 0 for the first channel and 8
+   for the second from the base in the controller's BAR 4. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prd(CHANNEL) ((CHANNEL)->bm_base + 4)     /* PRD table. */
+
+/* PCI class and subclass of an IDE controller, and the BAR that
+   holds its bus master registers. */
+#define PCI_CLASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE 0x01
+#define BM_BAR 4
+
+/* Programming interface bits that put each channel in native
+   mode, at ports other than the legacy ones we use. */
+#define PROG_IF_NATIVE(CHAN_NO) (0x01 << (CHAN_NO) * 2)
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits.  ERROR and INTR are cleared
+   by writing 1 to them. */
+#define BM_STA_ACTIVE 0x01      /* Transfer in progress. */
+#define BM_STA_ERROR 0x02       /* Transfer failed. */
+#define BM_STA_INTR 0x04        /* Disk raised its interrupt. */
+#define BM_STA_DMA0 0x20        /* Device 0 is set up for DMA. */
+#define BM_STA_DMA1 0x40        /* Device 1 is set up for DMA. */
+
+/* Physical Region Descriptor, one entry in the table that tells
+   the bus master where to transfer data.  A region must not
+   cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t paddr;             /* Physical address of region. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT in last entry. */
+  };
+
+#define PRD_EOT 0x8000          /* End of table. */
+#define PRD_CNT (PGSIZE / sizeof (struct prd))
+
+/* Most sectors to transfer with a single command.  The sector
+   count register allows up to 256, but splitting larger requests
+   keeps one request from holding the channel for too long. */
+#define MAX_XFER_SECTORS 128
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +134,10 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool use_dma;               /* Transfer by DMA? */
+    int multiple;               /* Sectors per READ/WRITE MULTIPLE block,
+                                   or 0 to transfer PIO sector by sector. */
+    struct block *block;        /* Block device, once registered. */
   };
 
 /* An ATA channel (aka controller).
@@ -72,6 +153,11 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base I/O port, or 0. */
+    struct prd *prd;            /* PRD table, if bus master. */
+    uint8_t *bounce;            /* Page for buffers DMA can't reach. */
+    uint8_t bm_status;          /* Bus master status at last interrupt. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
@@ -85,10 +171,32 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
-static void issue_pio_command (struct channel *, uint8_t command);
+static void init_bus_master (struct channel *, int chan_no,
+                             struct pci_device *);
+
+static void set_multiple_mode (struct ata_disk *, int sectors);
+
+static void ide_read_multi (void *, block_sector_t, block_sector_t cnt,
+                            void *);
+static void ide_write_multi (void *, block_sector_t, block_sector_t cnt,
+                             const void *);
+static block_sector_t xfer_sectors (const struct ata_disk *, const void *,
+                                    block_sector_t cnt);
+static bool pio_read (struct ata_disk *, uint8_t *, block_sector_t cnt);
+static bool pio_write (struct ata_disk *, const uint8_t *,
+                       block_sector_t cnt);
+static bool dma_read (struct ata_disk *, uint8_t *, block_sector_t cnt);
+static bool dma_write (struct ata_disk *, const uint8_t *,
+                       block_sector_t cnt);
+
+static void select_sectors (struct ata_disk *, block_sector_t,
+                            block_sector_t cnt);
+static void issue_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
+static bool dma_addressable (const void *);
+static bool dma_transfer (struct ata_disk *, uint8_t command,
+                          const void *, size_t, bool to_memory);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -101,6 +209,8 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void) 
 {
+  struct pci_device *pci = pci_find_class (PCI_CLASS_STORAGE,
+                                           PCI_SUBCLASS_IDE);
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -126,6 +236,7 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      init_bus_master (c, chan_no, pci);
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +247,9 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->use_dma = false;
+          d->multiple = 0;
+          d->block = NULL;
         }
 
       /* Register interrupt handler. */
@@ -155,6 +269,39 @@ ide_init (void)
     }
 }
 
+/* Sets up channel C, which is number CHAN_NO, to transfer by
+   bus-master DMA if PCI function PCI is a bus-master IDE
+   controller that runs C at the legacy ports.  PCI may be a null
+   pointer if there is no PCI IDE controller. */
+static void
+init_bus_master (struct channel *c, int chan_no, struct pci_device *pci)
+{
+  uint16_t bm_base;
+
+  c->bm_base = 0;
+  c->prd = NULL;
+  c->bounce = NULL;
+  if (ide_pio || pci == NULL || (pci->prog_if & PROG_IF_NATIVE (chan_no)))
+    return;
+
+  bm_base = pci_io_bar (pci, BM_BAR);
+  if (bm_base == 0)
+    return;
+
+  c->prd = palloc_get_page (0);
+  c->bounce = palloc_get_page (0);
+  if (c->prd == NULL || c->bounce == NULL)
+    {
+      palloc_free_page (c->prd);
+      palloc_free_page (c->bounce);
+      c->prd = NULL;
+      c->bounce = NULL;
+      return;
+    }
+  c->bm_base = bm_base + chan_no * 8;
+  pci_enable (pci, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+}
+
 /* Disk detection and identification. */
 
 static char *descramble_ata_string (char *, int size);
@@ -261,6 +408,8 @@ identify_ata_device (struct ata_disk *d)
 {
   struct channel *c = d->channel;
   char id[BLOCK_SECTOR_SIZE];
+  uint16_t capabilities;
+  int max_multiple;
   block_sector_t capacity;
   char *model, *serial;
   char extra_info[128];
@@ -272,7 +421,7 @@ identify_ata_device (struct ata_disk *d)
      indicating the device's response is ready, and read the data
      into our buffer. */
   select_device_wait (d);
-  issue_pio_command (c, CMD_IDENTIFY_DEVICE);
+  issue_command (c, CMD_IDENTIFY_DEVICE);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     {
@@ -286,8 +435,22 @@ identify_ata_device (struct ata_disk *d)
   capacity = *(uint32_t *) &id[60 * 2];
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
+  capabilities = *(uint16_t *) &id[ID_CAPABILITIES * 2];
+  max_multiple = *(uint16_t *) &id[ID_MAX_MULTIPLE * 2] & 0xff;
+
+  /* Use DMA if both the controller and the disk support it. */
+  if (c->bm_base != 0 && (capabilities & ID_CAP_DMA) != 0)
+    {
+      d->use_dma = true;
+      outb (reg_bm_status (c), (inb (reg_bm_status (c))
+                                | (d->dev_no == 0 ? BM_STA_DMA0
+                                   : BM_STA_DMA1)));
+    }
+  else if (max_multiple > 1)
+    set_multiple_mode (d, max_multiple);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\", %s", model, serial,
+            d->use_dma ? "DMA" : d->multiple > 0 ? "PIO multiple" : "PIO");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
@@ -304,11 +467,36 @@ identify_ata_device (struct ata_disk *d)
     }
 
   /* Register. */
-  block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
-                          &ide_operations, d);
+  d->block = block = block_register (d->name, BLOCK_RAW, extra_info,
+                                     capacity, &ide_operations, d);
   partition_scan (block);
 }
 
+/* Sets up disk D to transfer up to MAX sectors per interrupt
+   with READ MULTIPLE and WRITE MULTIPLE.  The disk accepts only
+   powers of 2, so rounds MAX down to one.  If the disk refuses,
+   PIO stays one sector per interrupt.
+
+   SET MULTIPLE MODE transfers no data, so the disk never sets
+   DRQ for it: success is BSY and ERR both clear. */
+static void
+set_multiple_mode (struct ata_disk *d, int max)
+{
+  struct channel *c = d->channel;
+  int sectors = 1;
+
+  while (sectors * 2 <= max)
+    sectors *= 2;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), sectors);
+  issue_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & (STA_BSY | STA_ERR)) == 0)
+    d->multiple = sectors;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -342,58 +530,205 @@ descramble_ata_string (char *string, int size)
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multi (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multi (d, sec_no, 1, buffer);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Uses
+   one command for each MAX_XFER_SECTORS sectors.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multi (void *d_, block_sector_t sec_no, block_sector_t cnt,
+                void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      block_sector_t n = xfer_sectors (d, buffer, cnt);
+
+      select_sectors (d, sec_no, n);
+      if (!(d->use_dma ? dma_read (d, buffer, n) : pio_read (d, buffer, n)))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+      block_count_command (d->block, false);
+
+      sec_no += n;
+      cnt -= n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Uses one
+   command for each MAX_XFER_SECTORS sectors.  Returns after the
+   disk has acknowledged receiving all of the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multi (void *d_, block_sector_t sec_no, block_sector_t cnt,
+                 const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      block_sector_t n = xfer_sectors (d, buffer, cnt);
+
+      select_sectors (d, sec_no, n);
+      if (!(d->use_dma ? dma_write (d, buffer, n)
+            : pio_write (d, buffer, n)))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+      block_count_command (d->block, true);
+
+      sec_no += n;
+      cnt -= n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+    }
   lock_release (&c->lock);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multi,
+    ide_write_multi,
+    NULL
   };
-
+
+/* Returns the number of sectors, out of CNT, to move between
+   disk D and BUFFER in one command. */
+static block_sector_t
+xfer_sectors (const struct ata_disk *d, const void *buffer,
+              block_sector_t cnt)
+{
+  block_sector_t max = MAX_XFER_SECTORS;
+
+  /* A transfer through the bounce page must fit in it. */
+  if (d->use_dma && !dma_addressable (buffer))
+    max = PGSIZE / BLOCK_SECTOR_SIZE;
+  return cnt < max ? cnt : max;
+}
+
+/* Reads CNT sectors, already selected, from disk D into BUFFER
+   with PIO.  Returns true if successful, false on error.
+
+   The disk interrupts once for each block of sectors that it has
+   ready: d->multiple sectors at a time if READ MULTIPLE is set
+   up, otherwise one at a time. */
+static bool
+pio_read (struct ata_disk *d, uint8_t *buffer, block_sector_t cnt)
+{
+  struct channel *c = d->channel;
+  block_sector_t per_block = d->multiple > 0 ? d->multiple : 1;
+  block_sector_t i;
+
+  issue_command (c, (d->multiple > 0 ? CMD_READ_MULTIPLE
+                     : CMD_READ_SECTOR_RETRY));
+  for (i = 0; i < cnt; i++)
+    {
+      if (i % per_block == 0)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            return false;
+        }
+      input_sector (c, buffer + i * BLOCK_SECTOR_SIZE);
+    }
+  return true;
+}
+
+/* Writes CNT sectors, already selected, to disk D from BUFFER
+   with PIO, a block of sectors at a time as in pio_read().
+   Returns true if successful, false on error. */
+static bool
+pio_write (struct ata_disk *d, const uint8_t *buffer, block_sector_t cnt)
+{
+  struct channel *c = d->channel;
+  block_sector_t per_block = d->multiple > 0 ? d->multiple : 1;
+  block_sector_t i;
+
+  issue_command (c, (d->multiple > 0 ? CMD_WRITE_MULTIPLE
+                     : CMD_WRITE_SECTOR_RETRY));
+  for (i = 0; i < cnt; i++)
+    {
+      if (i % per_block == 0 && !wait_while_busy (d))
+        return false;
+      output_sector (c, buffer + i * BLOCK_SECTOR_SIZE);
+      if (i % per_block == per_block - 1 || i == cnt - 1)
+        sema_down (&c->completion_wait);
+    }
+  return true;
+}
+
+/* Reads CNT sectors, already selected, from disk D into BUFFER
+   by DMA.  Returns true if successful, false on error. */
+static bool
+dma_read (struct ata_disk *d, uint8_t *buffer, block_sector_t cnt)
+{
+  struct channel *c = d->channel;
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+  void *target = dma_addressable (buffer) ? buffer : c->bounce;
+
+  if (!dma_transfer (d, CMD_READ_DMA, target, size, true))
+    return false;
+  if (target != buffer)
+    memcpy (buffer, target, size);
+  return true;
+}
+
+/* Writes CNT sectors, already selected, to disk D from BUFFER by
+   DMA.  Returns true if successful, false on error. */
+static bool
+dma_write (struct ata_disk *d, const uint8_t *buffer, block_sector_t cnt)
+{
+  struct channel *c = d->channel;
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+  const void *source = buffer;
+
+  if (!dma_addressable (buffer))
+    {
+      memcpy (c->bounce, buffer, size);
+      source = c->bounce;
+    }
+  return dma_transfer (d, CMD_WRITE_DMA, source, size, false);
+}
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection and
+   sector count registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no,
+                block_sector_t cnt)
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= 256);
+  ASSERT (sec_no < (1UL << 28) && cnt <= (1UL << 28) - sec_no);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);            /* 0 means 256. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -404,7 +739,7 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 /* Writes COMMAND to channel C and prepares for receiving a
    completion interrupt. */
 static void
-issue_pio_command (struct channel *c, uint8_t command) 
+issue_command (struct channel *c, uint8_t command) 
 {
   /* Interrupts must be enabled or our semaphore will never be
      up'd by the completion handler. */
@@ -429,6 +764,73 @@ output_sector (struct channel *c, const void *sector)
 {
   outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
 }
+
+/* Returns true if the bus master can transfer directly to or
+   from BUFFER.  It needs BUFFER's physical address, which we know
+   only for kernel virtual addresses, and that address must be
+   even.  Other buffers, such as those in user memory that file
+   system calls pass down, go through the channel's bounce page,
+   which costs a memcpy() but is still much cheaper than PIO. */
+static bool
+dma_addressable (const void *buffer)
+{
+  return is_kernel_vaddr (buffer) && ((uintptr_t) buffer & 1) == 0;
+}
+
+/* Transfers SIZE bytes between BUFFER and disk D by DMA, using
+   COMMAND, which must be CMD_READ_DMA if TO_MEMORY is true or
+   CMD_WRITE_DMA if it is false.  D's channel must be locked and
+   the sectors selected.  Returns true if successful, false on
+   error.  BUFFER must be addressable by DMA.
+
+   Kernel virtual memory maps physical memory contiguously, so
+   BUFFER needs a new region only where it crosses a 64 kB
+   boundary. */
+static bool
+dma_transfer (struct ata_disk *d, uint8_t command,
+              const void *buffer, size_t size, bool to_memory)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = to_memory ? BM_CMD_READ : 0;
+  uintptr_t paddr = vtop (buffer);
+  struct prd *prd = c->prd;
+
+  ASSERT (size > 0);
+  ASSERT (dma_addressable (buffer));
+
+  /* Build the PRD table. */
+  while (size > 0)
+    {
+      size_t chunk = 0x10000 - (paddr & 0xffff);
+      if (chunk > size)
+        chunk = size;
+
+      ASSERT (prd < c->prd + PRD_CNT);
+      prd->paddr = paddr;
+      prd->size = chunk & 0xffff;
+      prd->flags = 0;
+      prd++;
+
+      paddr += chunk;
+      size -= chunk;
+    }
+  prd[-1].flags = PRD_EOT;
+
+  /* Point the bus master at the table, clear its error and
+     interrupt bits, set the direction, and start the transfer
+     once the disk has the command. */
+  outl (reg_bm_prd (c), vtop (c->prd));
+  outb (reg_bm_status (c), inb (reg_bm_status (c)));
+  outb (reg_bm_command (c), direction);
+  issue_command (c, command);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+
+  sema_down (&c->completion_wait);
+  outb (reg_bm_command (c), direction);
+
+  return ((c->bm_status & (BM_STA_ERROR | BM_STA_ACTIVE)) == 0
+          && (inb (reg_alt_status (c)) & (STA_BSY | STA_ERR)) == 0);
+}
 
 /* Low-level ATA primitives. */
 
@@ -514,6 +916,12 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
+            if (c->bm_base != 0)
+              {
+                /* Save and clear the bus master's status. */
+                c->bm_status = inb (reg_bm_status (c));
+                outb (reg_bm_status (c), c->bm_status);
+              }
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
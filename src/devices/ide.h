@@ -1,6 +1,12 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
+/* Use programmed I/O even if DMA is available, enabled by kernel
+   command-line option "-pio". */
+extern bool ide_pio;
+
 void ide_init (void);
 
 #endif /* devices/ide.h */
@@ -17,8 +17,10 @@
    protect kernel threads from one another, not from interrupt
    handlers. */
 
-/* Queue buffer size, in bytes. */
-#define INTQ_BUFSIZE 64
+/* Queue buffer size, in bytes.  Large enough that the serial
+   port's transmit queue can absorb a burst of console output
+   without making the writer wait for the port to drain it. */
+#define INTQ_BUFSIZE 1024
 
 /* A circular queue of bytes. */
 struct intq
@@ -7,6 +7,7 @@
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/workqueue.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -24,12 +25,26 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the interrupt handler but not yet decoded.
+   The interrupt handler only reads scancodes from the keyboard
+   controller into this buffer.  Decoding them into characters
+   is deferred to kbd_work, which runs in a worker thread. */
+#define SCANCODE_BUF_SIZE 64
+static unsigned scancodes[SCANCODE_BUF_SIZE];
+static unsigned scancode_head;  /* Next scancode is written here. */
+static unsigned scancode_tail;  /* Oldest scancode is read here. */
+static int64_t scancode_drops;  /* Scancodes lost to a full buffer. */
+static struct work kbd_work;
+
 static intr_handler_func keyboard_interrupt;
+static work_func decode_scancodes;
+static void decode_scancode (unsigned code);
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) 
 {
+  work_init (&kbd_work, decode_scancodes, NULL);
   intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -37,7 +52,8 @@ kbd_init (void)
 void
 kbd_print_stats (void) 
 {
-  printf ("Keyboard: %lld keys pressed\n", key_cnt);
+  printf ("Keyboard: %lld keys pressed, %lld scancodes dropped\n",
+          key_cnt, scancode_drops);
 }
 
 /* Maps a set of contiguous scancodes into characters. */
@@ -92,28 +108,65 @@ static const struct keymap shifted_keymap[] =
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
 
+/* Keyboard interrupt handler.  Reads the scancode and leaves
+   the rest to decode_scancodes(). */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) 
+{
+  /* Keyboard scancode. */
+  unsigned code;
+
+  /* Read scancode, including second byte if prefix code. */
+  code = inb (DATA_REG);
+  if (code == 0xe0)
+    code = (code << 8) | inb (DATA_REG);
+
+  if (scancode_head - scancode_tail < SCANCODE_BUF_SIZE)
+    {
+      scancodes[scancode_head++ % SCANCODE_BUF_SIZE] = code;
+      work_queue (&kbd_work);
+    }
+  else
+    scancode_drops++;
+}
+
+/* Decodes every scancode read by the interrupt handler so far.
+   Runs in a worker thread. */
+static void
+decode_scancodes (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      bool empty = scancode_tail == scancode_head;
+      unsigned code = 0;
+
+      if (!empty)
+        code = scancodes[scancode_tail++ % SCANCODE_BUF_SIZE];
+      intr_set_level (old_level);
+
+      if (empty)
+        break;
+      decode_scancode (code);
+    }
+}
+
+/* Interprets scancode CODE, updating the state of the shift
+   keys or adding a character to the input buffer. */
+static void
+decode_scancode (unsigned code)
 {
   /* Status of shift keys. */
   bool shift = left_shift || right_shift;
   bool alt = left_alt || right_alt;
   bool ctrl = left_ctrl || right_ctrl;
 
-  /* Keyboard scancode. */
-  unsigned code;
-
   /* False if key pressed, true if key released. */
   bool release;
 
   /* Character that corresponds to `code'. */
   uint8_t c;
 
-  /* Read scancode, including second byte if prefix code. */
-  code = inb (DATA_REG);
-  if (code == 0xe0)
-    code = (code << 8) | inb (DATA_REG);
-
   /* Bit 0x80 distinguishes key press from key release
      (even if there's a prefix). */
   release = (code & 0x80) != 0;
@@ -133,6 +186,8 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
       /* Ordinary character. */
       if (!release) 
         {
+          enum intr_level old_level;
+
           /* Reboot if Ctrl+Alt+Del pressed. */
           if (c == 0177 && ctrl && alt)
             shutdown_reboot ();
@@ -154,11 +209,13 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
             c += 0x80;
 
           /* Append to keyboard buffer. */
+          old_level = intr_disable ();
           if (!input_full ())
             {
               key_cnt++;
               input_putc (c);
             }
+          intr_set_level (old_level);
         }
     }
   else
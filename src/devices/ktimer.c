@@ -0,0 +1,278 @@
+#include "devices/ktimer.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+
+/* The timing wheel.
+
+   The wheel has WHEEL_LEVELS levels of slots, each slot a list
+   of timers.  Level 0 has one slot for each of the next
+   ROOT_SLOTS ticks.  Each slot of level 1 covers ROOT_SLOTS
+   ticks, each slot of level 2 covers LEVEL_SLOTS times as many,
+   and so on, so that a timer's level depends only on how far in
+   the future it expires and its slot only on the bits of its
+   expiry tick that select a slot at that level.
+
+   Every tick, the timers in the current level-0 slot expire.
+   Whenever the level-0 index wraps around to 0, the next slot of
+   level 1 is emptied and its timers re-added, which places them
+   in level 0 because they now expire within ROOT_SLOTS ticks;
+   when the level-1 index wraps around, level 2 cascades into
+   level 1 the same way, and so on.  Each timer cascades at most
+   once per level, so the cost of expiring timers stays constant
+   per timer.
+
+   Timers further in the future than the wheel spans are placed
+   in the last slot that the outermost level reaches and keep
+   cascading from there until they come within range. */
+#define ROOT_BITS 8
+#define ROOT_SLOTS (1 << ROOT_BITS)
+#define LEVEL_BITS 6
+#define LEVEL_SLOTS (1 << LEVEL_BITS)
+#define WHEEL_LEVELS 5
+
+/* Number of ticks spanned by the whole wheel. */
+#define WHEEL_SPAN ((int64_t) 1 << (ROOT_BITS                           \
+                                    + (WHEEL_LEVELS - 1) * LEVEL_BITS))
+
+static struct list root_slots[ROOT_SLOTS];
+static struct list level_slots[WHEEL_LEVELS - 1][LEVEL_SLOTS];
+
+/* Next tick whose timers have not yet expired. */
+static int64_t wheel_tick;
+
+/* Number of pending timers. */
+static size_t pending_cnt;
+
+static void enqueue (struct ktimer *);
+static void cascade (int level);
+
+/* Initializes the timing wheel. */
+void
+ktimer_wheel_init (void)
+{
+  int level, i;
+
+  for (i = 0; i < ROOT_SLOTS; i++)
+    list_init (&root_slots[i]);
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    for (i = 0; i < LEVEL_SLOTS; i++)
+      list_init (&level_slots[level][i]);
+}
+
+/* Initializes TIMER to call FUNC, passing AUX, when it expires.
+   The timer is not pending until it is added. */
+void
+ktimer_init (struct ktimer *timer, ktimer_func *func, void *aux)
+{
+  ASSERT (timer != NULL);
+  ASSERT (func != NULL);
+
+  timer->func = func;
+  timer->aux = aux;
+  timer->expires = 0;
+  timer->pending = false;
+}
+
+/* Adds TIMER, which must not be pending, to expire at timer tick
+   TICK.  If TICK has already passed, the timer expires at the
+   next tick.
+
+   This function may be called from an interrupt handler. */
+void
+ktimer_add (struct ktimer *timer, int64_t tick)
+{
+  enum intr_level old_level;
+
+  ASSERT (timer != NULL);
+  ASSERT (!timer->pending);
+
+  old_level = intr_disable ();
+  timer->expires = tick;
+  timer->pending = true;
+  pending_cnt++;
+  enqueue (timer);
+  intr_set_level (old_level);
+}
+
+/* Changes TIMER to expire at timer tick TICK, adding it if it is
+   not pending.  Returns true if TIMER was pending, false
+   otherwise.
+
+   This function may be called from an interrupt handler. */
+bool
+ktimer_modify (struct ktimer *timer, int64_t tick)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = ktimer_cancel (timer);
+  ktimer_add (timer, tick);
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Cancels TIMER, so that it does not expire.  Returns true if
+   TIMER was pending, false if it had already expired or was
+   never added.
+
+   Canceling a timer does not wait for its function to finish if
+   it is already running, but a timer's function runs with
+   interrupts off, so a thread that cancels a timer with
+   interrupts off knows that the function either has run or will
+   not.
+
+   This function may be called from an interrupt handler. */
+bool
+ktimer_cancel (struct ktimer *timer)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (timer != NULL);
+
+  old_level = intr_disable ();
+  was_pending = timer->pending;
+  if (was_pending)
+    {
+      list_remove (&timer->elem);
+      timer->pending = false;
+      pending_cnt--;
+    }
+  intr_set_level (old_level);
+
+  return was_pending;
+}
+
+/* Returns true if TIMER has been added and has neither expired
+   nor been canceled. */
+bool
+ktimer_pending (const struct ktimer *timer)
+{
+  ASSERT (timer != NULL);
+
+  return timer->pending;
+}
+
+/* Expires every timer due at or before timer tick NOW.  Called
+   by the timer interrupt handler.
+
+   If some ticks passed without a call, as happens during
+   tickless idle, their timers expire now, in order. */
+void
+ktimer_run (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_tick <= now)
+    {
+      struct list *slot = &root_slots[wheel_tick % ROOT_SLOTS];
+      struct list expired;
+
+      /* Cascade each level whose index has wrapped around. */
+      if (wheel_tick % ROOT_SLOTS == 0)
+        {
+          int level;
+
+          for (level = 0; level < WHEEL_LEVELS - 1; level++)
+            {
+              cascade (level);
+              if (((wheel_tick >> (ROOT_BITS + level * LEVEL_BITS))
+                   % LEVEL_SLOTS) != 0)
+                break;
+            }
+        }
+
+      /* Take the expired timers out of the wheel before calling
+         any of their functions, and advance the wheel first, so
+         that a function that re-adds its timer for this tick or
+         earlier puts it in the next tick's slot instead of this
+         one. */
+      list_init (&expired);
+      if (!list_empty (slot))
+        list_splice (list_end (&expired), list_begin (slot), list_end (slot));
+      wheel_tick++;
+
+      while (!list_empty (&expired))
+        {
+          struct ktimer *timer = list_entry (list_pop_front (&expired),
+                                             struct ktimer, elem);
+          timer->pending = false;
+          pending_cnt--;
+          timer->func (timer->aux);
+        }
+    }
+}
+
+/* Returns the next timer tick at which ktimer_run() may have
+   timers to expire, or INT64_MAX if no timers are pending.  The
+   answer may be early, at a tick where timers only cascade
+   between levels, but it is never late.  Interrupts must be off.
+
+   Used by tickless idle to decide how long the CPU may sleep. */
+int64_t
+ktimer_next_tick (void)
+{
+  int64_t tick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (pending_cnt == 0)
+    return INT64_MAX;
+
+  /* Look for a nonempty slot before level 0 wraps around, which
+     may cascade more timers into it.  Timers for ticks that have
+     already passed sit in the current slot. */
+  for (tick = wheel_tick; tick % ROOT_SLOTS != 0; tick++)
+    if (!list_empty (&root_slots[tick % ROOT_SLOTS]))
+      return tick;
+  return tick;
+}
+
+/* Puts TIMER in the wheel slot for its expiry tick. */
+static void
+enqueue (struct ktimer *timer)
+{
+  int64_t expires = timer->expires;
+  int64_t delta = expires - wheel_tick;
+  struct list *slot;
+
+  if (delta < 0)
+    slot = &root_slots[wheel_tick % ROOT_SLOTS];
+  else if (delta < ROOT_SLOTS)
+    slot = &root_slots[expires % ROOT_SLOTS];
+  else
+    {
+      int level;
+
+      if (delta >= WHEEL_SPAN)
+        expires = wheel_tick + WHEEL_SPAN - 1;
+      for (level = 0; level < WHEEL_LEVELS - 2; level++)
+        if (delta < (int64_t) 1 << (ROOT_BITS + (level + 1) * LEVEL_BITS))
+          break;
+      slot = &level_slots[level][(expires >> (ROOT_BITS
+                                               + level * LEVEL_BITS))
+                                 % LEVEL_SLOTS];
+    }
+  list_push_back (slot, &timer->elem);
+}
+
+/* Re-adds the timers in LEVEL's slot for the current tick, which
+   moves each of them one or more levels closer to level 0.  The
+   timers are re-added in order, so that timers that expire at
+   the same tick still expire in the order they were added, as
+   long as they were added at the same level. */
+static void
+cascade (int level)
+{
+  int64_t shift = ROOT_BITS + level * LEVEL_BITS;
+  struct list *slot = &level_slots[level][(wheel_tick >> shift)
+                                          % LEVEL_SLOTS];
+  struct list timers;
+
+  if (list_empty (slot))
+    return;
+
+  list_init (&timers);
+  list_splice (list_end (&timers), list_begin (slot), list_end (slot));
+  while (!list_empty (&timers))
+    enqueue (list_entry (list_pop_front (&timers), struct ktimer, elem));
+}
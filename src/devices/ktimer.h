@@ -0,0 +1,44 @@
+#ifndef DEVICES_KTIMER_H
+#define DEVICES_KTIMER_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel timers.
+
+   A kernel timer calls a function at a given timer tick.  The
+   function runs in the timer interrupt handler, with interrupts
+   off, so it must not sleep and should return quickly; it may
+   add, modify, or cancel timers, including its own.
+
+   Pending timers are kept in a hierarchical timing wheel, so
+   adding, modifying, canceling, and expiring a timer each take
+   constant time regardless of how many timers are pending. */
+
+/* Function called when a timer expires, with the timer's AUX. */
+typedef void ktimer_func (void *aux);
+
+/* A kernel timer. */
+struct ktimer
+  {
+    struct list_elem elem;      /* Element in a wheel slot. */
+    int64_t expires;            /* Tick at which to call FUNC. */
+    ktimer_func *func;          /* Function to call. */
+    void *aux;                  /* Argument for FUNC. */
+    bool pending;               /* In the wheel? */
+  };
+
+void ktimer_wheel_init (void);
+
+void ktimer_init (struct ktimer *, ktimer_func *, void *aux);
+void ktimer_add (struct ktimer *, int64_t tick);
+bool ktimer_modify (struct ktimer *, int64_t tick);
+bool ktimer_cancel (struct ktimer *);
+bool ktimer_pending (const struct ktimer *);
+
+/* Called by the timer device. */
+void ktimer_run (int64_t now);
+int64_t ktimer_next_tick (void);
+
+#endif /* devices/ktimer.h */
@@ -0,0 +1,217 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Local APIC.
+
+   Each CPU has its own local APIC, which delivers interrupts to
+   it, counts down its timer, and sends and receives
+   interprocessor interrupts (IPIs).  The registers are mapped at
+   the same physical address on every CPU, each CPU seeing its own
+   APIC there.
+
+   Pintos uses the local APICs to start the application
+   processors, to send reschedule IPIs, and for the timer tick on
+   the application processors.  Device interrupts still come from
+   the 8259A PICs, which are wired to the bootstrap processor's
+   LINT0 pin and pass through its local APIC ("virtual wire
+   mode").
+
+   Refer to [IA32-v3a] chapter 8 "Advanced Programmable Interrupt
+   Controller (APIC)" for hardware information. */
+
+/* Register offsets, in bytes. */
+#define ID_REG 0x020            /* Local APIC ID. */
+#define TPR_REG 0x080           /* Task Priority Register. */
+#define EOI_REG 0x0b0           /* End Of Interrupt. */
+#define SVR_REG 0x0f0           /* Spurious Interrupt Vector Register. */
+#define ICR_LO_REG 0x300        /* Interrupt Command Register, bits 0-31. */
+#define ICR_HI_REG 0x310        /* Interrupt Command Register, bits 32-63. */
+#define TIMER_REG 0x320         /* LVT Timer Register. */
+#define LINT0_REG 0x350         /* LVT LINT0 Register. */
+#define LINT1_REG 0x360         /* LVT LINT1 Register. */
+#define TIMER_INIT_REG 0x380    /* Timer Initial Count. */
+#define TIMER_CUR_REG 0x390     /* Timer Current Count. */
+#define TIMER_DIV_REG 0x3e0     /* Timer Divide Configuration. */
+
+/* Spurious Interrupt Vector Register bits. */
+#define SVR_ENABLE 0x100        /* APIC software enable. */
+
+/* Local Vector Table register bits. */
+#define LVT_NMI 0x400           /* Deliver as NMI. */
+#define LVT_EXTINT 0x700        /* Deliver as if from an 8259A PIC. */
+#define LVT_MASKED 0x10000      /* Interrupt masked. */
+#define LVT_PERIODIC 0x20000    /* Timer restarts when it reaches 0. */
+
+/* Interrupt Command Register bits. */
+#define ICR_INIT 0x500          /* INIT delivery mode. */
+#define ICR_STARTUP 0x600       /* Start-up delivery mode. */
+#define ICR_PENDING 0x1000      /* Delivery status: send pending. */
+#define ICR_ASSERT 0x4000       /* Level: assert, not de-assert. */
+#define ICR_LEVEL 0x8000        /* Level-triggered, not edge. */
+
+/* Timer Divide Configuration Register value: divide by 16. */
+#define TIMER_DIV_16 0x3
+
+/* Local APIC registers, mapped at their own physical address. */
+static volatile uint32_t *lapic;
+
+/* Timer counts per timer tick, measured by lapic_init(). */
+static uint32_t timer_count;
+
+static void enable (void);
+static void send_icr (int apic_id, uint32_t command);
+
+static inline uint32_t
+lapic_read (int reg)
+{
+  return lapic[reg / sizeof *lapic];
+}
+
+static inline void
+lapic_write (int reg, uint32_t value)
+{
+  lapic[reg / sizeof *lapic] = value;
+}
+
+/* Maps the local APIC registers at physical address PADDR into
+   the kernel's page table, enables the bootstrap processor's
+   local APIC in virtual wire mode, and measures how fast the
+   local APIC timers count.  Must be called after
+   timer_calibrate() and before any page directory is created
+   from init_page_dir.
+
+   The mapping is at virtual address PADDR, which is far above
+   the kernel's mapping of RAM, and disables caching, as memory-
+   mapped device registers need. */
+void
+lapic_init (uint32_t paddr)
+{
+  void *vaddr = (void *) paddr;
+  enum intr_level old_level;
+  uint32_t *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0);
+  ASSERT (vaddr >= ptov (init_ram_pages * PGSIZE));
+  ASSERT (init_page_dir[pd_no (vaddr)] == 0);
+
+  pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pt[pt_no (vaddr)] = paddr | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+  init_page_dir[pd_no (vaddr)] = pde_create (pt);
+  lapic = vaddr;
+
+  enable ();
+  lapic_write (LINT0_REG, LVT_EXTINT);
+  lapic_write (LINT1_REG, LVT_NMI);
+
+  /* Count down from the top for one tick's worth of time.  With
+     interrupts off, the tick that this covers stays pending
+     rather than being lost. */
+  old_level = intr_disable ();
+  lapic_write (TIMER_DIV_REG, TIMER_DIV_16);
+  lapic_write (TIMER_REG, LVT_MASKED);
+  lapic_write (TIMER_INIT_REG, UINT32_MAX);
+  timer_udelay (1000 * 1000 / TIMER_FREQ);
+  timer_count = UINT32_MAX - lapic_read (TIMER_CUR_REG);
+  lapic_write (TIMER_INIT_REG, 0);
+  intr_set_level (old_level);
+}
+
+/* Sets up the local APIC of the application processor that
+   calls it: enables it, masks its local interrupt pins, which
+   only the bootstrap processor uses, and starts its timer
+   interrupting TIMER_FREQ times per second. */
+void
+lapic_init_ap (void)
+{
+  ASSERT (lapic != NULL);
+
+  enable ();
+  lapic_write (LINT0_REG, LVT_MASKED);
+  lapic_write (LINT1_REG, LVT_MASKED);
+  lapic_write (TIMER_DIV_REG, TIMER_DIV_16);
+  lapic_write (TIMER_REG, LVT_PERIODIC | LAPIC_TIMER_VEC);
+  lapic_write (TIMER_INIT_REG, timer_count);
+}
+
+/* Returns the local APIC ID of the running CPU. */
+int
+lapic_id (void)
+{
+  return lapic_read (ID_REG) >> 24;
+}
+
+/* Acknowledges the interrupt that the local APIC is delivering,
+   so that it will deliver the next one. */
+void
+lapic_eoi (void)
+{
+  lapic_write (EOI_REG, 0);
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is
+   APIC_ID. */
+void
+lapic_send_ipi (int apic_id, int vec)
+{
+  ASSERT (vec >= LAPIC_VEC_BASE && vec < LAPIC_SPURIOUS_VEC);
+
+  send_icr (apic_id, vec);
+}
+
+/* Starts the application processor whose local APIC ID is
+   APIC_ID executing in real mode at START_PADDR, which must be a
+   page boundary below 1 MB, with the INIT, startup, startup
+   sequence from appendix B.4 of the Intel MultiProcessor
+   Specification. */
+void
+lapic_start_ap (int apic_id, uint32_t start_paddr)
+{
+  int i;
+
+  ASSERT (start_paddr % PGSIZE == 0 && start_paddr < 0x100000);
+
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  timer_udelay (200);
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+  timer_mdelay (10);
+
+  for (i = 0; i < 2; i++)
+    {
+      send_icr (apic_id, ICR_STARTUP | (start_paddr / PGSIZE));
+      timer_udelay (200);
+    }
+}
+
+/* Software-enables the running CPU's local APIC, with
+   LAPIC_SPURIOUS_VEC as its spurious interrupt vector, and lets
+   it deliver interrupts of every priority. */
+static void
+enable (void)
+{
+  lapic_write (SVR_REG, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (TPR_REG, 0);
+}
+
+/* Sends COMMAND to the CPU whose local APIC ID is APIC_ID and
+   waits for the local APIC to accept it.  Interrupts are off
+   while the two halves of the command register are written, so
+   that an interrupt handler sending an IPI cannot get between
+   them. */
+static void
+send_icr (int apic_id, uint32_t command)
+{
+  enum intr_level old_level = intr_disable ();
+
+  lapic_write (ICR_HI_REG, (uint32_t) apic_id << 24);
+  lapic_write (ICR_LO_REG, command);
+  while (lapic_read (ICR_LO_REG) & ICR_PENDING)
+    asm volatile ("pause");
+
+  intr_set_level (old_level);
+}
@@ -0,0 +1,19 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdint.h>
+
+/* Interrupt vectors 0xf0...0xff are raised by the local APIC. */
+#define LAPIC_VEC_BASE 0xf0
+#define LAPIC_TIMER_VEC 0xf0    /* Local APIC timer. */
+#define LAPIC_IPI_VEC 0xf1      /* Reschedule IPI from another CPU. */
+#define LAPIC_SPURIOUS_VEC 0xff /* Spurious interrupt. */
+
+void lapic_init (uint32_t paddr);
+void lapic_init_ap (void);
+int lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (int apic_id, int vec);
+void lapic_start_ap (int apic_id, uint32_t start_paddr);
+
+#endif /* devices/lapic.h */
@@ -0,0 +1,261 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/io.h"
+
+/* PCI configuration space access.
+
+   Uses configuration mechanism #1: a 32-bit address naming a
+   bus, device, function, and register is written to
+   CONFIG_ADDRESS, and then the register's doubleword can be read
+   or written at CONFIG_DATA.  Refer to the PCI Local Bus
+   Specification, revision 2.1 or later, section 3.2.2.3.2.
+
+   pci_init() finds the functions present by walking bus 0 and
+   every bus behind a PCI-to-PCI bridge.  Drivers then look up
+   their devices with pci_find_class() or pci_find_device(). */
+
+/* Configuration mechanism #1 ports. */
+#define CONFIG_ADDRESS 0xcf8
+#define CONFIG_DATA 0xcfc
+
+/* Enable bit in CONFIG_ADDRESS. */
+#define CONFIG_ENABLE 0x80000000
+
+/* Configuration space registers used only here. */
+#define PCI_VENDOR_ID 0x00      /* Vendor ID (16 bits). */
+#define PCI_DEVICE_ID 0x02      /* Device ID (16 bits). */
+#define PCI_CLASS_REV 0x08      /* Class code and revision (32 bits). */
+#define PCI_HEADER_TYPE 0x0e    /* Header type (8 bits). */
+#define PCI_SECONDARY_BUS 0x19  /* Bridge's secondary bus (8 bits). */
+#define PCI_INTERRUPT_LINE 0x3c /* Interrupt line (8 bits). */
+
+/* Header type bits. */
+#define HEADER_MULTIFUNCTION 0x80       /* Device has functions 1...7. */
+
+/* Class and subclass of a PCI-to-PCI bridge. */
+#define CLASS_BRIDGE 0x06
+#define SUBCLASS_PCI_BRIDGE 0x04
+
+/* Base address register bits. */
+#define BAR_IO 0x00000001       /* I/O space, not memory space. */
+#define BAR_IO_MASK 0xfffffffc  /* Base of I/O space BAR. */
+
+/* Functions found by pci_init(). */
+#define PCI_DEVICE_MAX 32
+static struct pci_device devices[PCI_DEVICE_MAX];
+static size_t device_cnt;
+
+static void scan_bus (uint8_t bus);
+static void scan_function (uint8_t bus, uint8_t dev, uint8_t func);
+static uint32_t read_config (uint8_t bus, uint8_t dev, uint8_t func,
+                             int reg);
+
+/* Finds the PCI functions in the system. */
+void
+pci_init (void)
+{
+  scan_bus (0);
+  printf ("PCI: %zu functions found.\n", device_cnt);
+}
+
+/* Returns the first PCI function with the given CLASS and
+   SUBCLASS, or a null pointer if there is none. */
+struct pci_device *
+pci_find_class (uint8_t class, uint8_t subclass)
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++)
+    if (devices[i].class == class && devices[i].subclass == subclass)
+      return &devices[i];
+  return NULL;
+}
+
+/* Returns the first PCI function with the given VENDOR_ID and
+   DEVICE_ID, or a null pointer if there is none. */
+struct pci_device *
+pci_find_device (uint16_t vendor_id, uint16_t device_id)
+{
+  return pci_find_next_device (NULL, vendor_id, device_id);
+}
+
+/* Returns the next PCI function after PREV, or the first one if
+   PREV is a null pointer, with the given VENDOR_ID and
+   DEVICE_ID, or a null pointer if there is none. */
+struct pci_device *
+pci_find_next_device (struct pci_device *prev,
+                      uint16_t vendor_id, uint16_t device_id)
+{
+  size_t i;
+
+  for (i = prev != NULL ? prev - devices + 1 : 0; i < device_cnt; i++)
+    if (devices[i].vendor_id == vendor_id
+        && devices[i].device_id == device_id)
+      return &devices[i];
+  return NULL;
+}
+
+/* Returns the 32-bit configuration register at offset REG in
+   PCI function D.  REG must be a multiple of 4. */
+uint32_t
+pci_read_config32 (const struct pci_device *d, int reg)
+{
+  ASSERT (reg % 4 == 0);
+
+  return read_config (d->bus, d->dev, d->func, reg);
+}
+
+/* Returns the 16-bit configuration register at offset REG in
+   PCI function D.  REG must be a multiple of 2. */
+uint16_t
+pci_read_config16 (const struct pci_device *d, int reg)
+{
+  ASSERT (reg % 2 == 0);
+
+  return read_config (d->bus, d->dev, d->func, reg & ~3) >> (reg & 3) * 8;
+}
+
+/* Returns the 8-bit configuration register at offset REG in PCI
+   function D. */
+uint8_t
+pci_read_config8 (const struct pci_device *d, int reg)
+{
+  return read_config (d->bus, d->dev, d->func, reg & ~3) >> (reg & 3) * 8;
+}
+
+/* Writes VALUE to the 32-bit configuration register at offset
+   REG in PCI function D.  REG must be a multiple of 4. */
+void
+pci_write_config32 (const struct pci_device *d, int reg, uint32_t value)
+{
+  enum intr_level old_level;
+
+  ASSERT (reg % 4 == 0);
+
+  old_level = intr_disable ();
+  outl (CONFIG_ADDRESS, (CONFIG_ENABLE | d->bus << 16 | d->dev << 11
+                         | d->func << 8 | reg));
+  outl (CONFIG_DATA, value);
+  intr_set_level (old_level);
+}
+
+/* Writes VALUE to the 16-bit configuration register at offset
+   REG in PCI function D.  REG must be a multiple of 2. */
+void
+pci_write_config16 (const struct pci_device *d, int reg, uint16_t value)
+{
+  enum intr_level old_level;
+
+  ASSERT (reg % 2 == 0);
+
+  old_level = intr_disable ();
+  outl (CONFIG_ADDRESS, (CONFIG_ENABLE | d->bus << 16 | d->dev << 11
+                         | d->func << 8 | (reg & ~3)));
+  outw (CONFIG_DATA + (reg & 3), value);
+  intr_set_level (old_level);
+}
+
+/* Returns the I/O port base of base address register BAR in PCI
+   function D, or 0 if BAR is unused or maps memory space. */
+uint16_t
+pci_io_bar (const struct pci_device *d, int bar)
+{
+  uint32_t value;
+
+  ASSERT (bar >= 0 && bar < PCI_BAR_CNT);
+
+  value = pci_read_config32 (d, PCI_BAR0 + bar * 4);
+  return (value & BAR_IO) != 0 ? value & BAR_IO_MASK : 0;
+}
+
+/* Sets COMMAND_BITS, some combination of PCI_COMMAND_IO,
+   PCI_COMMAND_MEMORY, and PCI_COMMAND_MASTER, in PCI function
+   D's command register. */
+void
+pci_enable (const struct pci_device *d, uint16_t command_bits)
+{
+  uint16_t command = pci_read_config16 (d, PCI_COMMAND);
+  if ((command & command_bits) != command_bits)
+    pci_write_config16 (d, PCI_COMMAND, command | command_bits);
+}
+
+/* Records the functions of each device on BUS, recursing into
+   the buses behind any PCI-to-PCI bridges. */
+static void
+scan_bus (uint8_t bus)
+{
+  uint8_t dev;
+
+  for (dev = 0; dev < 32; dev++)
+    {
+      uint8_t func, func_cnt;
+
+      if ((read_config (bus, dev, 0, PCI_VENDOR_ID) & 0xffff) == 0xffff)
+        continue;
+
+      func_cnt = ((read_config (bus, dev, 0, PCI_HEADER_TYPE & ~3)
+                   >> (PCI_HEADER_TYPE & 3) * 8)
+                  & HEADER_MULTIFUNCTION) ? 8 : 1;
+      for (func = 0; func < func_cnt; func++)
+        scan_function (bus, dev, func);
+    }
+}
+
+/* Records function FUNC of device DEV on BUS, if it exists. */
+static void
+scan_function (uint8_t bus, uint8_t dev, uint8_t func)
+{
+  uint32_t id = read_config (bus, dev, func, PCI_VENDOR_ID);
+  uint32_t class_rev;
+  struct pci_device *d;
+
+  if ((id & 0xffff) == 0xffff)
+    return;
+  if (device_cnt >= PCI_DEVICE_MAX)
+    {
+      printf ("PCI: too many functions, ignoring %02x:%02x.%x\n",
+              bus, dev, func);
+      return;
+    }
+
+  d = &devices[device_cnt++];
+  class_rev = read_config (bus, dev, func, PCI_CLASS_REV);
+  d->bus = bus;
+  d->dev = dev;
+  d->func = func;
+  d->vendor_id = id & 0xffff;
+  d->device_id = id >> 16;
+  d->class = class_rev >> 24;
+  d->subclass = class_rev >> 16;
+  d->prog_if = class_rev >> 8;
+  d->irq = pci_read_config8 (d, PCI_INTERRUPT_LINE);
+
+  if (d->class == CLASS_BRIDGE && d->subclass == SUBCLASS_PCI_BRIDGE)
+    {
+      uint8_t secondary = pci_read_config8 (d, PCI_SECONDARY_BUS);
+      if (secondary > bus)
+        scan_bus (secondary);
+    }
+}
+
+/* Reads the doubleword at offset REG in the configuration space
+   of function FUNC of device DEV on BUS. */
+static uint32_t
+read_config (uint8_t bus, uint8_t dev, uint8_t func, int reg)
+{
+  enum intr_level old_level;
+  uint32_t value;
+
+  ASSERT (dev < 32 && func < 8 && reg % 4 == 0 && reg < 256);
+
+  old_level = intr_disable ();
+  outl (CONFIG_ADDRESS, (CONFIG_ENABLE | bus << 16 | dev << 11
+                         | func << 8 | reg));
+  value = inl (CONFIG_DATA);
+  intr_set_level (old_level);
+
+  return value;
+}
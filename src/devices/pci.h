@@ -0,0 +1,48 @@
+#ifndef DEVICES_PCI_H
+#define DEVICES_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A PCI function found by pci_init(). */
+struct pci_device
+  {
+    uint8_t bus;                /* Bus number. */
+    uint8_t dev;                /* Device number on bus, 0...31. */
+    uint8_t func;               /* Function number in device, 0...7. */
+    uint16_t vendor_id;         /* Vendor ID. */
+    uint16_t device_id;         /* Device ID. */
+    uint8_t class;              /* Base class code. */
+    uint8_t subclass;           /* Subclass code. */
+    uint8_t prog_if;            /* Programming interface. */
+    uint8_t irq;                /* Interrupt line, as set up by BIOS. */
+  };
+
+/* Configuration space registers. */
+#define PCI_COMMAND 0x04        /* Command register (16 bits). */
+#define PCI_BAR0 0x10           /* First base address register. */
+#define PCI_BAR_CNT 6           /* Number of base address registers. */
+
+/* Command register bits. */
+#define PCI_COMMAND_IO 0x0001           /* Respond to I/O space accesses. */
+#define PCI_COMMAND_MEMORY 0x0002       /* Respond to memory accesses. */
+#define PCI_COMMAND_MASTER 0x0004       /* Act as bus master. */
+
+void pci_init (void);
+
+struct pci_device *pci_find_class (uint8_t class, uint8_t subclass);
+struct pci_device *pci_find_device (uint16_t vendor_id, uint16_t device_id);
+struct pci_device *pci_find_next_device (struct pci_device *prev,
+                                         uint16_t vendor_id,
+                                         uint16_t device_id);
+
+uint32_t pci_read_config32 (const struct pci_device *, int reg);
+uint16_t pci_read_config16 (const struct pci_device *, int reg);
+uint8_t pci_read_config8 (const struct pci_device *, int reg);
+void pci_write_config32 (const struct pci_device *, int reg, uint32_t);
+void pci_write_config16 (const struct pci_device *, int reg, uint16_t);
+
+uint16_t pci_io_bar (const struct pci_device *, int bar);
+void pci_enable (const struct pci_device *, uint16_t command_bits);
+
+#endif /* devices/pci.h */
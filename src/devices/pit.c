@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -39,7 +36,8 @@
        it is 1, for the second half it is 0.  This is useful for
        generating a tone on a speaker.
 
-     - Other modes are less useful.
+     - Other modes are less useful here.  See pit_start_oneshot()
+       for mode 0.
 
    FREQUENCY is the number of periods per second, in Hz. */
 void
@@ -81,3 +79,46 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts a one-shot countdown of COUNT PIT cycles on CHANNEL,
+   using mode 0 ("interrupt on terminal count"): the channel's
+   output goes high, raising an interrupt on channel 0, once
+   COUNT cycles have elapsed, and then the channel stays idle
+   until it is reconfigured.  A COUNT of 0 is treated as 65536.
+   This replaces any periodic mode set up by
+   pit_configure_channel(). */
+void
+pit_start_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's counter, that is, the
+   number of PIT cycles left until it next reaches 0.  Uses the
+   "counter latch" command so that the two bytes are read
+   consistently.  In mode 0 the counter keeps counting down past
+   0, wrapping around to 65535. */
+uint16_t
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint16_t count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
@@ -0,0 +1,171 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM disk.
+
+   A block device whose sectors live in memory, so that reading
+   and writing it costs only a memcpy().  Its contents do not
+   survive a reboot, which suits scratch, swap, or a file system
+   that is formatted at startup.
+
+   The memory comes from the user pool, so that a RAM disk does
+   not compete with the kernel's own allocations, in runs of up
+   to RUN_PAGES contiguous pages.  A transfer copies as much as
+   it can at once from each run it touches. */
+
+/* Most pages to allocate at once. */
+#define RUN_PAGES 1024
+
+/* Sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    size_t page_cnt;            /* Number of pages. */
+    uint8_t **pages;            /* Kernel virtual address of each page. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+static uint8_t *locate (const struct ramdisk *, block_sector_t,
+                        block_sector_t *cnt);
+
+/* Creates a RAM disk of SIZE bytes, rounded up to a whole number
+   of pages, and registers it as block device "ram0".  Panics if
+   the user pool does not have enough free pages. */
+void
+ramdisk_init (size_t size)
+{
+  struct ramdisk *rd;
+  size_t i;
+
+  if (size == 0)
+    return;
+
+  rd = malloc (sizeof *rd);
+  if (rd != NULL)
+    {
+      rd->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+      rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+    }
+  if (rd == NULL || rd->pages == NULL)
+    PANIC ("ramdisk: out of memory for page table");
+
+  /* Take the largest runs the user pool can give, halving the
+     run size each time an allocation fails. */
+  for (i = 0; i < rd->page_cnt; )
+    {
+      size_t run = rd->page_cnt - i < RUN_PAGES ? rd->page_cnt - i
+                                                : RUN_PAGES;
+      uint8_t *base;
+
+      while ((base = palloc_get_multiple (PAL_USER | PAL_ZERO, run)) == NULL)
+        {
+          if (run == 1)
+            PANIC ("ramdisk: out of memory after %zu of %zu pages",
+                   i, rd->page_cnt);
+          run /= 2;
+        }
+      for (; run > 0; run--, i++, base += PGSIZE)
+        rd->pages[i] = base;
+    }
+
+  block_register ("ram0", BLOCK_RAW, "RAM disk",
+                  rd->page_cnt * PAGE_SECTORS, &ramdisk_operations, rd);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD into
+   BUFFER. */
+static void
+ramdisk_read_multi (void *rd, block_sector_t sector, block_sector_t cnt,
+                    void *buffer_)
+{
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      block_sector_t n = cnt;
+      const uint8_t *src = locate (rd, sector, &n);
+
+      memcpy (buffer, src, n * BLOCK_SECTOR_SIZE);
+      sector += n;
+      cnt -= n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+    }
+}
+
+/* Writes CNT sectors starting at SECTOR to RAM disk RD from
+   BUFFER. */
+static void
+ramdisk_write_multi (void *rd, block_sector_t sector, block_sector_t cnt,
+                     const void *buffer_)
+{
+  const uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      block_sector_t n = cnt;
+      uint8_t *dst = locate (rd, sector, &n);
+
+      memcpy (dst, buffer, n * BLOCK_SECTOR_SIZE);
+      sector += n;
+      cnt -= n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+    }
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multi (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multi (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multi,
+    ramdisk_write_multi,
+    NULL
+  };
+
+/* Returns the address of SECTOR in RAM disk RD.  Reduces *CNT,
+   if necessary, to the number of sectors from there on that are
+   contiguous in memory. */
+static uint8_t *
+locate (const struct ramdisk *rd, block_sector_t sector,
+        block_sector_t *cnt)
+{
+  size_t page = sector / PAGE_SECTORS;
+  block_sector_t ofs = sector % PAGE_SECTORS;
+  block_sector_t contiguous = PAGE_SECTORS - ofs;
+
+  ASSERT (page < rd->page_cnt);
+
+  while (contiguous < *cnt && page + 1 < rd->page_cnt
+         && rd->pages[page + 1] == rd->pages[page] + PGSIZE)
+    {
+      contiguous += PAGE_SECTORS;
+      page++;
+    }
+  if (contiguous < *cnt)
+    *cnt = contiguous;
+
+  return rd->pages[sector / PAGE_SECTORS] + ofs * BLOCK_SECTOR_SIZE;
+}
@@ -33,6 +33,15 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Clear the receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Clear the transmit FIFO. */
+#define FCR_TRIGGER_1 0x00      /* Receive interrupt after 1 byte. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set if FIFOs are enabled. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -47,6 +56,14 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+
+/* Size of the 16550A's transmit FIFO, in bytes.  Once THRE
+   reports the FIFO empty, this many bytes may be written without
+   checking again. */
+#define XMIT_FIFO_SIZE 16
+
+/* Data rate, in bits per second. */
+#define SERIAL_BPS 115200
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -54,6 +71,16 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Number of bytes the transmitter holds once THRE is set:
+   XMIT_FIFO_SIZE if the UART has a working FIFO, otherwise 1
+   (an 8250 or 16450, or a 16550 with a broken FIFO). */
+static int xmit_size;
+
+/* Number of bytes that we know the transmit FIFO has room for.
+   Only our own writes use up room, and the FIFO only drains, so
+   the real amount of room is at least this much. */
+static int xmit_room;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
@@ -68,8 +95,11 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
-  set_serial (9600);                    /* 9.6 kbps, N-8-1. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT
+        | FCR_TRIGGER_1);               /* Enable and clear FIFOs. */
+  xmit_size = ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO
+               ? XMIT_FIFO_SIZE : 1);   /* Did the FIFOs turn on? */
+  set_serial (SERIAL_BPS);              /* 115.2 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
   mode = POLL;
@@ -194,15 +224,21 @@ write_ier (void)
 }
 
 /* Polls the serial port until it's ready,
-   and then transmits BYTE. */
+   and then transmits BYTE.  Waits for the transmit FIFO to drain
+   only once every xmit_size bytes. */
 static void
 putc_poll (uint8_t byte) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  while ((inb (LSR_REG) & LSR_THRE) == 0)
-    continue;
+  if (xmit_room == 0)
+    {
+      while ((inb (LSR_REG) & LSR_THRE) == 0)
+        continue;
+      xmit_room = xmit_size;
+    }
   outb (THR_REG, byte);
+  xmit_room--;
 }
 
 /* Serial interrupt handler. */
@@ -218,10 +254,16 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO is empty, refill it with as many bytes
+     as it holds, so that we take one transmit interrupt per
+     xmit_size bytes instead of one per byte. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0)
+    xmit_room = xmit_size;
+  while (!intq_empty (&txq) && xmit_room > 0)
+    {
+      outb (THR_REG, intq_getc (&txq));
+      xmit_room--;
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -6,8 +6,11 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/fpu.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -95,6 +98,7 @@ shutdown_power_off (void)
 #endif
 
   print_stats ();
+  trace_dump ();
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -131,6 +135,7 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  workqueue_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -138,5 +143,6 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  fpu_print_stats ();
 #endif
 }
@@ -3,10 +3,13 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/ktimer.h"
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/mp.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -20,13 +23,61 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
+/* List of threads blocked in timer_sleep(), in order of
+   increasing wakeup_tick.  Threads with equal wakeup ticks are
+   kept in the order they went to sleep. */
+static struct list sleep_list;
+
+/* Time-stamp counter cycles per timer tick and per second.
    Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+static uint64_t cycles_per_tick;
+static uint64_t cycles_per_sec;
+
+/* Time-stamp counter value at tick 0, so that timer_ns() counts
+   from boot.  Initialized by timer_calibrate(). */
+static uint64_t boot_cycles;
+
+/* Ticks over which timer_calibrate() counts cycles. */
+#define CALIBRATE_TICKS 10
+
+/* Tickless idle.
+
+   If true, then whenever the idle thread halts the CPU, the PIT
+   is switched from periodic mode to a one-shot countdown that
+   ends at the next sleeper's wakeup tick or the next kernel
+   timer, so that the ticks in between raise no interrupts.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot countdown, in ticks, that fits in the PIT's
+   16-bit counter. */
+#define TICKLESS_MAX_TICKS (65535 / PIT_TICK_COUNT)
+
+/* Ticks covered by the running one-shot countdown, or 0 if the
+   PIT is in its normal periodic mode. */
+static int64_t tickless_ticks;
+
+/* PIT cycles in the running one-shot countdown, and the number
+   of those cycles until the first tick boundary within it.  Later
+   boundaries follow every PIT_TICK_COUNT cycles. */
+static uint16_t tickless_count;
+static uint16_t tickless_first;
+
+/* PIT cycles by which the periodic tick lags where it should be,
+   because restarting periodic mode after a countdown ran out
+   happened that long after the countdown's end.  Subtracted from
+   the next countdown, so that the lag does not accumulate. */
+static uint16_t tickless_lag;
+
+/* Number of timer interrupts avoided by tickless idle. */
+static int64_t tickless_avoided;
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static list_less_func wakeup_less;
+static int64_t wait_for_tick (void);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
@@ -36,34 +87,37 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  list_init (&sleep_list);
+  ktimer_wheel_init ();
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the CPU's time-stamp counter against the PIT, by
+   counting the cycles that pass during CALIBRATE_TICKS timer
+   ticks.  The time-stamp counter provides timer_cycles() and
+   timer_ns() and times brief delays.  Until this function has
+   been called, timer_ns() has only tick resolution and delays
+   return immediately. */
 void
 timer_calibrate (void) 
 {
-  unsigned high_bit, test_bit;
+  int64_t start_tick;
+  uint64_t start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
-  /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-  loops_per_tick = 1u << 10;
-  while (!too_many_loops (loops_per_tick << 1)) 
-    {
-      loops_per_tick <<= 1;
-      ASSERT (loops_per_tick != 0);
-    }
+  /* Count from one tick boundary to another. */
+  start_tick = wait_for_tick ();
+  start = timer_cycles ();
+  while (ticks < start_tick + CALIBRATE_TICKS)
+    barrier ();
 
-  /* Refine the next 8 bits of loops_per_tick. */
-  high_bit = loops_per_tick;
-  for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-    if (!too_many_loops (loops_per_tick | test_bit))
-      loops_per_tick |= test_bit;
+  cycles_per_tick = (timer_cycles () - start) / CALIBRATE_TICKS;
+  cycles_per_sec = cycles_per_tick * TIMER_FREQ;
+  boot_cycles = start - start_tick * cycles_per_tick;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" cycles/s.\n", cycles_per_sec);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,16 +138,58 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, with
+   the resolution of the time-stamp counter once the timer has
+   been calibrated, or of a timer tick before then. */
+int64_t
+timer_ns (void)
+{
+  uint64_t cycles;
+
+  if (cycles_per_sec == 0)
+    return timer_ticks () * (1000 * 1000 * 1000 / TIMER_FREQ);
+
+  /* Convert whole seconds and the remainder separately so that
+     the multiplication cannot overflow. */
+  cycles = timer_cycles () - boot_cycles;
+  return (cycles / cycles_per_sec * 1000 * 1000 * 1000
+          + cycles % cycles_per_sec * 1000 * 1000 * 1000 / cycles_per_sec);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread is blocked on sleep_list until
+   timer_interrupt() finds that its wakeup tick has arrived, so
+   it does not occupy the run queue while it sleeps. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  if (ticks > 0)
+    timer_sleep_until (timer_ticks () + ticks);
+}
+
+/* Sleeps until timer tick TICK.  Returns immediately if TICK
+   has already passed.  Interrupts must be turned on.
+
+   Unlike a loop of timer_sleep() calls, this does not drift
+   when used to wake up periodically. */
+void
+timer_sleep_until (int64_t tick)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+
+  old_level = intr_disable ();
+  if (tick > timer_ticks ())
+    {
+      cur->wakeup_tick = tick;
+      list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+      thread_block ();
+    }
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -163,48 +259,188 @@ timer_ndelay (int64_t ns)
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks, %'"PRIu64" cycles/s\n",
+          timer_ticks (), cycles_per_sec);
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" interrupts avoided by tickless idle\n",
+            tickless_avoided);
+}
+
+/* Starts a one-shot countdown of COUNT PIT cycles that covers
+   TICK_CNT ticks, the first of which ends FIRST cycles from
+   now. */
+static void
+tickless_start (int64_t tick_cnt, int count, int first)
+{
+  tickless_ticks = tick_cnt;
+  tickless_count = count;
+  tickless_first = first;
+  pit_start_oneshot (0, count);
 }
-
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled, reprograms the PIT
+   to interrupt once, at the next tick that has work to do,
+   instead of at every tick.
+
+   The countdown is cut short to the next multiple of 4 ticks
+   under the MLFQS, which has periodic bookkeeping to do even
+   when the system is idle.
+
+   The CPU usually goes idle partway through a tick, so the
+   countdown first runs out the part of the current tick that the
+   periodic counter has left, then whole ticks.  That keeps the
+   tick boundaries where the periodic timer would have put them.
+
+   With more than one CPU running, the bootstrap processor keeps
+   ticking even when idle, because the other CPUs still need the
+   tick count that its timer interrupt advances. */
+void
+timer_idle_enter (void)
+{
+  int64_t idle_ticks = TICKLESS_MAX_TICKS;
+  int64_t next_timer;
+  int first;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || tickless_ticks != 0 || mp_cpu_cnt () > 1)
+    return;
+
+  if (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick - ticks < idle_ticks)
+        idle_ticks = t->wakeup_tick - ticks;
+    }
+  next_timer = ktimer_next_tick ();
+  if (next_timer - ticks < idle_ticks)
+    idle_ticks = next_timer - ticks;
+  if (thread_mlfqs && 4 - ticks % 4 < idle_ticks)
+    idle_ticks = 4 - ticks % 4;
+
+  if (idle_ticks > 1)
+    {
+      first = pit_read_count (0) - tickless_lag;
+      if (first < 1)
+        first = 1;
+      tickless_lag = 0;
+      tickless_start (idle_ticks,
+                      (idle_ticks - 1) * PIT_TICK_COUNT + first, first);
+    }
+}
+
+/* Called at the start of every external interrupt.  If the CPU
+   was idling with a one-shot countdown running, accounts for the
+   ticks that passed without timer interrupts.
+
+   If the countdown ran out, this is the timer interrupt for its
+   last tick, which timer_interrupt() will count as usual, so
+   only the ticks before it are added here, and the PIT goes back
+   into periodic mode.  If some other device woke the CPU early,
+   the tick boundaries already passed are counted, and the part
+   of the tick in progress is carried over into a one-tick
+   countdown that ends at the next boundary, where the periodic
+   timer resumes. */
+void
+timer_idle_exit (void)
+{
+  uint16_t remaining;
+  int elapsed, passed, rest;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tickless_ticks == 0)
+    return;
+
+  remaining = pit_read_count (0);
+  if (remaining == 0 || remaining > tickless_count)
+    {
+      /* The counter ran out and wrapped around.  Periodic mode
+         restarts now, a little after the boundary it should
+         have restarted on. */
+      int overdue = (uint16_t) -remaining;
+      passed = tickless_ticks - 1;
+      tickless_lag = overdue < PIT_TICK_COUNT ? overdue : 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      tickless_ticks = 0;
+    }
+  else
+    {
+      /* Woken early.  Count the boundaries passed so far and
+         finish the current tick with another countdown. */
+      elapsed = tickless_count - remaining;
+      if (elapsed < tickless_first)
+        passed = 0;
+      else
+        passed = 1 + (elapsed - tickless_first) / PIT_TICK_COUNT;
+      rest = tickless_first + passed * PIT_TICK_COUNT - elapsed;
+      tickless_start (1, rest, rest);
+    }
+
+  ticks += passed;
+  tickless_avoided += passed;
+  thread_idle_ticks (passed);
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  bool woke = false;
+
   ticks++;
+  trace_event (TRACE_TICK, thread_tid (), ticks, 0);
+  ktimer_run (ticks);
+
+  /* Wake up every sleeper whose time has come.  sleep_list is
+     sorted, so we can stop at the first one still sleeping. */
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+      woke = true;
+    }
+  if (woke)
+    thread_check_preemption ();
+
   thread_tick ();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Returns true if sleeping thread A should wake up before
+   sleeping thread B, false otherwise. */
 static bool
-too_many_loops (unsigned loops) 
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
+/* Waits for the next timer tick to begin and returns its
+   number. */
+static int64_t
+wait_for_tick (void)
 {
-  /* Wait for a timer tick. */
   int64_t start = ticks;
   while (ticks == start)
     barrier ();
-
-  /* Run LOOPS loops. */
-  start = ticks;
-  busy_wait (loops);
-
-  /* If the tick count changed, we iterated too long. */
-  barrier ();
-  return start != ticks;
+  return ticks;
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
-
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) 
+/* Returns the number of time-stamp counter cycles in NUM/DENOM
+   seconds. */
+static uint64_t
+real_time_cycles (int64_t num, int32_t denom)
 {
-  while (loops-- > 0)
-    barrier ();
+  return num * cycles_per_sec / denom;
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -227,11 +463,14 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
-  else 
+  else if (num > 0)
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
-      real_time_delay (num, denom); 
+      /* Otherwise, watch the time-stamp counter for accurate
+         sub-tick timing, yielding to any other ready threads
+         while we wait. */
+      uint64_t end = timer_cycles () + real_time_cycles (num, denom);
+      while (timer_cycles () < end)
+        thread_yield ();
     }
 }
 
@@ -239,8 +478,11 @@ real_time_sleep (int64_t num, int32_t denom)
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
-  /* Scale the numerator and denominator down by 1000 to avoid
-     the possibility of overflow. */
-  ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
+  uint64_t end;
+
+  if (num <= 0)
+    return;
+  end = timer_cycles () + real_time_cycles (num, denom);
+  while (timer_cycles () < end)
+    barrier ();
 }
@@ -0,0 +1,418 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "devices/partition.h"
+#include "devices/pci.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Virtio block device driver.
+
+   Virtio is the interface that QEMU and other hypervisors offer
+   for paravirtual devices.  Instead of emulating the registers
+   of real hardware one access at a time, as for IDE, the guest
+   and the hypervisor share a "virtqueue" in memory: the guest
+   puts requests in it and notifies the device with a single
+   port write, and the device puts completed requests back and
+   raises an interrupt.  Several requests may be in progress at
+   once.
+
+   We use the legacy PCI interface, with registers in I/O space,
+   which QEMU's transitional virtio-blk devices provide.  Refer
+   to the Virtio specification, version 1.0, sections 2.4
+   "Virtqueues", 4.1.4.8 "Legacy Interfaces: A Note on PCI Device
+   Layout", and 5.2 "Block Device". */
+
+/* PCI vendor and device ID of a transitional virtio-blk device. */
+#define VIRTIO_VENDOR_ID 0x1af4
+#define VIRTIO_BLK_DEVICE_ID 0x1001
+
+/* Legacy virtio register port addresses, in BAR 0. */
+#define reg_guest_features(VD) ((VD)->io_base + 0x04)  /* Features. */
+#define reg_queue_pfn(VD) ((VD)->io_base + 0x08)       /* Queue page. */
+#define reg_queue_size(VD) ((VD)->io_base + 0x0c)      /* Queue size. */
+#define reg_queue_select(VD) ((VD)->io_base + 0x0e)    /* Queue select. */
+#define reg_queue_notify(VD) ((VD)->io_base + 0x10)    /* Queue notify. */
+#define reg_status(VD) ((VD)->io_base + 0x12)          /* Device status. */
+#define reg_isr(VD) ((VD)->io_base + 0x13)             /* ISR status. */
+#define reg_capacity(VD) ((VD)->io_base + 0x14)        /* Sectors, 64 bits. */
+
+/* Device Status Register bits. */
+#define STA_ACKNOWLEDGE 0x01    /* Guest has noticed the device. */
+#define STA_DRIVER 0x02         /* Guest has a driver for it. */
+#define STA_DRIVER_OK 0x04      /* Driver is ready. */
+#define STA_FAILED 0x80         /* Driver gave up on the device. */
+
+/* ISR Status Register bits.  Reading the register clears it. */
+#define ISR_QUEUE 0x01          /* Used ring was updated. */
+
+/* Virtqueue descriptor, which points to one buffer. */
+struct vring_desc
+  {
+    uint64_t addr;              /* Physical address of buffer. */
+    uint32_t len;               /* Length of buffer. */
+    uint16_t flags;             /* VRING_DESC_F_* flags. */
+    uint16_t next;              /* Next descriptor, if VRING_DESC_F_NEXT. */
+  };
+
+#define VRING_DESC_F_NEXT 1     /* Chain continues at NEXT. */
+#define VRING_DESC_F_WRITE 2    /* Device writes buffer, not reads. */
+
+/* Ring of descriptor chains that the driver offers the device. */
+struct vring_avail
+  {
+    uint16_t flags;             /* Unused. */
+    uint16_t idx;               /* Where the driver puts the next entry. */
+    uint16_t ring[];            /* First descriptor of each chain. */
+  };
+
+/* Ring of descriptor chains that the device has finished with. */
+struct vring_used_elem
+  {
+    uint32_t id;                /* First descriptor of chain. */
+    uint32_t len;               /* Bytes written into chain. */
+  };
+
+struct vring_used
+  {
+    uint16_t flags;             /* Unused. */
+    uint16_t idx;               /* Where the device puts the next entry. */
+    struct vring_used_elem ring[];
+  };
+
+/* Header at the start of each virtio-blk request. */
+struct request_header
+  {
+    uint32_t type;              /* TYPE_IN or TYPE_OUT. */
+    uint32_t reserved;          /* Zero. */
+    uint64_t sector;            /* First sector. */
+  };
+
+#define TYPE_IN 0               /* Read from the device. */
+#define TYPE_OUT 1              /* Write to the device. */
+#define STATUS_OK 0             /* Request succeeded. */
+
+/* A request slot.  Slot I always uses the chain of three
+   descriptors starting at I * SLOT_DESCS: the header, the data
+   buffer, and the status byte. */
+struct slot
+  {
+    struct request_header header;   /* Read by device. */
+    uint8_t status;                 /* Written by device. */
+    bool busy;                      /* In use? */
+    struct semaphore done;          /* Up'd by interrupt handler. */
+  };
+
+#define SLOT_DESCS 3
+
+/* Most requests to keep in progress on one device. */
+#define SLOT_MAX 16
+
+/* A virtio block device. */
+struct virtio_blk
+  {
+    char name[8];               /* Name, e.g. "vda". */
+    uint16_t io_base;           /* Base I/O port. */
+    uint8_t irq;                /* Interrupt in use. */
+
+    uint16_t queue_size;        /* Entries in each ring, a power of 2. */
+    struct vring_desc *desc;    /* Descriptor table. */
+    volatile struct vring_avail *avail; /* Available ring. */
+    volatile struct vring_used *used;   /* Used ring. */
+    uint16_t last_used;         /* Used ring index last processed. */
+
+    struct slot *slots;         /* Request slots. */
+    int slot_cnt;               /* Number of slots. */
+    struct semaphore free_slots;        /* Number of free slots. */
+  };
+
+/* Virtio block devices found. */
+#define DEVICE_MAX 4
+static struct virtio_blk devices[DEVICE_MAX];
+static size_t device_cnt;
+
+/* Whether we have registered a handler for each IRQ. */
+static bool irq_registered[16];
+
+static struct block_operations virtio_blk_operations;
+
+static void init_device (struct pci_device *);
+static bool init_queue (struct virtio_blk *, uint16_t queue_size);
+static void transfer (struct virtio_blk *, uint32_t type, block_sector_t,
+                      block_sector_t cnt, void *);
+static intr_handler_func interrupt_handler;
+
+/* Finds and initializes the virtio block devices. */
+void
+virtio_blk_init (void) 
+{
+  struct pci_device *pci = NULL;
+
+  while ((pci = pci_find_next_device (pci, VIRTIO_VENDOR_ID,
+                                      VIRTIO_BLK_DEVICE_ID)) != NULL)
+    init_device (pci);
+}
+
+/* Initializes the virtio block device that is PCI function PCI,
+   and registers it and its partitions with the block device
+   layer. */
+static void
+init_device (struct pci_device *pci) 
+{
+  struct virtio_blk *vd;
+  struct block *block;
+  uint64_t capacity;
+  uint16_t queue_size;
+  char extra_info[32];
+
+  if (device_cnt >= DEVICE_MAX)
+    {
+      printf ("virtio-blk: too many devices, ignoring %02x:%02x.%x\n",
+              pci->bus, pci->dev, pci->func);
+      return;
+    }
+  vd = &devices[device_cnt];
+  snprintf (vd->name, sizeof vd->name, "vd%c", 'a' + (int) device_cnt);
+  vd->io_base = pci_io_bar (pci, 0);
+  vd->irq = pci->irq;
+  if (vd->io_base == 0 || vd->irq >= 16)
+    {
+      printf ("%s: no legacy I/O ports or interrupt, ignoring\n", vd->name);
+      return;
+    }
+  pci_enable (pci, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+
+  /* Reset the device, then tell it that we have a driver for
+     it.  We need none of the optional features. */
+  outb (reg_status (vd), 0);
+  outb (reg_status (vd), STA_ACKNOWLEDGE);
+  outb (reg_status (vd), STA_ACKNOWLEDGE | STA_DRIVER);
+  outl (reg_guest_features (vd), 0);
+
+  /* Set up queue 0, the request queue. */
+  outw (reg_queue_select (vd), 0);
+  queue_size = inw (reg_queue_size (vd));
+  if (queue_size == 0 || !init_queue (vd, queue_size))
+    {
+      printf ("%s: cannot set up request queue, ignoring\n", vd->name);
+      outb (reg_status (vd), STA_FAILED);
+      return;
+    }
+  outl (reg_queue_pfn (vd), vtop (vd->desc) >> PGBITS);
+
+  /* Start taking interrupts.  Devices may share an IRQ, so one
+     handler serves them all. */
+  device_cnt++;
+  if (!irq_registered[vd->irq])
+    {
+      intr_register_ext (0x20 + vd->irq, interrupt_handler, "virtio-blk");
+      irq_registered[vd->irq] = true;
+    }
+  outb (reg_status (vd), STA_ACKNOWLEDGE | STA_DRIVER | STA_DRIVER_OK);
+
+  /* Register. */
+  capacity = (inl (reg_capacity (vd))
+              | (uint64_t) inl (reg_capacity (vd) + 4) << 32);
+  if (capacity > UINT32_MAX)
+    capacity = UINT32_MAX;
+  snprintf (extra_info, sizeof extra_info, "virtio, %d requests at once",
+            vd->slot_cnt);
+  block = block_register (vd->name, BLOCK_RAW, extra_info, capacity,
+                          &virtio_blk_operations, vd);
+  block_set_queue_depth (block, vd->slot_cnt);
+  partition_scan (block);
+}
+
+/* Allocates and initializes VD's virtqueue, with QUEUE_SIZE
+   entries in each ring, and its request slots.  Returns true if
+   successful, false if memory is short.
+
+   The legacy interface fixes the virtqueue's layout: the
+   descriptor table and then the available ring, and then, at
+   the next page boundary, the used ring, all physically
+   contiguous. */
+static bool
+init_queue (struct virtio_blk *vd, uint16_t queue_size) 
+{
+  size_t used_ofs = ROUND_UP (sizeof *vd->desc * queue_size
+                              + sizeof *vd->avail
+                              + sizeof *vd->avail->ring * (queue_size + 1),
+                              PGSIZE);
+  size_t page_cnt = DIV_ROUND_UP (used_ofs + sizeof *vd->used
+                                  + sizeof *vd->used->ring * queue_size
+                                  + sizeof (uint16_t), PGSIZE);
+  uint8_t *queue;
+  int i;
+
+  queue = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (queue == NULL)
+    return false;
+  vd->queue_size = queue_size;
+  vd->desc = (struct vring_desc *) queue;
+  vd->avail = (struct vring_avail *) (queue + sizeof *vd->desc * queue_size);
+  vd->used = (struct vring_used *) (queue + used_ofs);
+  vd->last_used = 0;
+
+  vd->slot_cnt = queue_size / SLOT_DESCS < SLOT_MAX
+                 ? queue_size / SLOT_DESCS : SLOT_MAX;
+  vd->slots = calloc (vd->slot_cnt, sizeof *vd->slots);
+  if (vd->slots == NULL)
+    {
+      palloc_free_multiple (queue, page_cnt);
+      return false;
+    }
+  sema_init (&vd->free_slots, vd->slot_cnt);
+
+  /* Chain each slot's descriptors together once and for all. */
+  for (i = 0; i < vd->slot_cnt; i++)
+    {
+      struct vring_desc *d = &vd->desc[i * SLOT_DESCS];
+
+      sema_init (&vd->slots[i].done, 0);
+      d[0].flags = VRING_DESC_F_NEXT;
+      d[0].next = i * SLOT_DESCS + 1;
+      d[1].next = i * SLOT_DESCS + 2;
+      d[2].flags = VRING_DESC_F_WRITE;
+    }
+  return true;
+}
+
+/* Reads CNT sectors starting at SEC_NO from device VD into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  May be called by several threads at once. */
+static void
+virtio_blk_read_multi (void *vd, block_sector_t sec_no, block_sector_t cnt,
+                       void *buffer)
+{
+  transfer (vd, TYPE_IN, sec_no, cnt, buffer);
+}
+
+/* Writes CNT sectors starting at SEC_NO to device VD from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the device has acknowledged receiving the data.
+   May be called by several threads at once. */
+static void
+virtio_blk_write_multi (void *vd, block_sector_t sec_no, block_sector_t cnt,
+                        const void *buffer)
+{
+  transfer (vd, TYPE_OUT, sec_no, cnt, (void *) buffer);
+}
+
+/* Reads sector SEC_NO from device VD into BUFFER. */
+static void
+virtio_blk_read (void *vd, block_sector_t sec_no, void *buffer)
+{
+  transfer (vd, TYPE_IN, sec_no, 1, buffer);
+}
+
+/* Writes sector SEC_NO to device VD from BUFFER. */
+static void
+virtio_blk_write (void *vd, block_sector_t sec_no, const void *buffer)
+{
+  transfer (vd, TYPE_OUT, sec_no, 1, (void *) buffer);
+}
+
+static struct block_operations virtio_blk_operations =
+  {
+    virtio_blk_read,
+    virtio_blk_write,
+    virtio_blk_read_multi,
+    virtio_blk_write_multi,
+    NULL
+  };
+
+/* Carries out a request of the given TYPE for CNT sectors
+   starting at SEC_NO between device VD and BUFFER, which must be
+   in kernel memory, and waits for it to complete.  Panics if the
+   device reports an error. */
+static void
+transfer (struct virtio_blk *vd, uint32_t type, block_sector_t sec_no,
+          block_sector_t cnt, void *buffer) 
+{
+  enum intr_level old_level;
+  struct vring_desc *d;
+  struct slot *s;
+  int slot_no;
+
+  ASSERT (is_kernel_vaddr (buffer));
+
+  /* Claim a free slot. */
+  sema_down (&vd->free_slots);
+  old_level = intr_disable ();
+  for (slot_no = 0; vd->slots[slot_no].busy; slot_no++)
+    continue;
+  s = &vd->slots[slot_no];
+  s->busy = true;
+  intr_set_level (old_level);
+
+  /* Fill in the slot's descriptor chain.  Kernel virtual memory
+     maps physical memory contiguously, so one descriptor covers
+     the whole buffer. */
+  s->header.type = type;
+  s->header.reserved = 0;
+  s->header.sector = sec_no;
+  s->status = 0xff;
+  d = &vd->desc[slot_no * SLOT_DESCS];
+  d[0].addr = vtop (&s->header);
+  d[0].len = sizeof s->header;
+  d[1].addr = vtop (buffer);
+  d[1].len = cnt * BLOCK_SECTOR_SIZE;
+  d[1].flags = (VRING_DESC_F_NEXT
+                | (type == TYPE_IN ? VRING_DESC_F_WRITE : 0));
+  d[2].addr = vtop (&s->status);
+  d[2].len = 1;
+
+  /* Offer the chain to the device, publishing the ring entry
+     before the index that covers it, and notify the device. */
+  old_level = intr_disable ();
+  vd->avail->ring[vd->avail->idx % vd->queue_size] = slot_no * SLOT_DESCS;
+  barrier ();
+  vd->avail->idx++;
+  barrier ();
+  outw (reg_queue_notify (vd), 0);
+  intr_set_level (old_level);
+
+  sema_down (&s->done);
+  if (s->status != STATUS_OK)
+    PANIC ("%s: disk %s failed, sector=%"PRDSNu,
+           vd->name, type == TYPE_IN ? "read" : "write", sec_no);
+
+  old_level = intr_disable ();
+  s->busy = false;
+  intr_set_level (old_level);
+  sema_up (&vd->free_slots);
+}
+
+/* Virtio block interrupt handler.  Wakes up the thread waiting
+   on each request that a device sharing the interrupt has
+   completed. */
+static void
+interrupt_handler (struct intr_frame *f) 
+{
+  size_t i;
+
+  for (i = 0; i < device_cnt; i++)
+    {
+      struct virtio_blk *vd = &devices[i];
+
+      /* Reading the ISR acknowledges the interrupt. */
+      if ((int) f->vec_no != 0x20 + vd->irq
+          || (inb (reg_isr (vd)) & ISR_QUEUE) == 0)
+        continue;
+
+      while (vd->last_used != vd->used->idx)
+        {
+          uint32_t id = vd->used->ring[vd->last_used % vd->queue_size].id;
+          sema_up (&vd->slots[id / SLOT_DESCS].done);
+          vd->last_used++;
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -53,15 +54,42 @@ byte_to_sector (const struct inode *inode, off_t pos)
     return -1;
 }
 
+/* Returns the number of whole sectors of INODE, starting at the
+   sector that begins at byte offset POS, that lie within the
+   first SIZE bytes from POS and within the inode's length, and
+   that are consecutive on disk.  This is how many sectors a read
+   or write at POS can move in one block_read_multi() or
+   block_write_multi() call. */
+static block_sector_t
+contiguous_sectors (const struct inode *inode, off_t pos, off_t size)
+{
+  block_sector_t first = byte_to_sector (inode, pos);
+  block_sector_t cnt;
+
+  ASSERT (pos % BLOCK_SECTOR_SIZE == 0);
+
+  if (size > inode_length (inode) - pos)
+    size = inode_length (inode) - pos;
+  for (cnt = 0; (off_t) (cnt + 1) * BLOCK_SECTOR_SIZE <= size; cnt++)
+    if (byte_to_sector (inode, pos + cnt * BLOCK_SECTOR_SIZE) != first + cnt)
+      break;
+  return cnt;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open counts of its members, which
+   concurrent directory lookups update. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -105,31 +133,60 @@ inode_create (block_sector_t sector, off_t length)
   return success;
 }
 
-/* Reads an inode from SECTOR
-   and returns a `struct inode' that contains it.
-   Returns a null pointer if memory allocation fails. */
-struct inode *
-inode_open (block_sector_t sector)
+/* Returns the open inode for SECTOR, with its open count
+   incremented, or a null pointer if it is not open.
+   open_inodes_lock must be held. */
+static struct inode *
+reopen_sector (block_sector_t sector)
 {
   struct list_elem *e;
-  struct inode *inode;
 
-  /* Check whether this inode is already open. */
+  ASSERT (lock_held_by_current_thread (&open_inodes_lock));
+
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
-      inode = list_entry (e, struct inode, elem);
+      struct inode *inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
           return inode; 
         }
     }
+  return NULL;
+}
 
-  /* Allocate memory. */
+/* Reads an inode from SECTOR
+   and returns a `struct inode' that contains it.
+   Returns a null pointer if memory allocation fails. */
+struct inode *
+inode_open (block_sector_t sector)
+{
+  struct inode *inode, *other;
+
+  /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
+  inode = reopen_sector (sector);
+  lock_release (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  /* Allocate memory and read the inode without holding the lock,
+     so that other opens do not wait for the disk. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
     return NULL;
+  block_read (fs_device, sector, &inode->data);
+
+  /* Another thread may have opened the same inode meanwhile. */
+  lock_acquire (&open_inodes_lock);
+  other = reopen_sector (sector);
+  if (other != NULL)
+    {
+      lock_release (&open_inodes_lock);
+      free (inode);
+      return other;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -137,7 +194,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +203,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -168,10 +229,12 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -183,6 +246,8 @@ inode_close (struct inode *inode)
 
       free (inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -222,8 +287,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read this and any following full sectors that are
+             consecutive on disk directly into caller's buffer. */
+          block_sector_t cnt = contiguous_sectors (inode, offset, size);
+          block_read_multi (fs_device, sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -283,8 +351,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Write this and any following full sectors that are
+             consecutive on disk directly from caller's buffer. */
+          block_sector_t cnt = contiguous_sectors (inode, offset, size);
+          block_write_multi (fs_device, sector_idx, cnt,
+                             buffer + bytes_written);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -0,0 +1,208 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* See heap.h for basic information.
+
+   The heap is a tree in which every element is at least as
+   large as its children, stored as a leftmost child plus a
+   doubly linked list of siblings.  Two heaps are melded by
+   making the root with the smaller key the leftmost child of
+   the other.  Removing an element melds its children back
+   together in two passes, first pairing them off left to right
+   and then melding the pairs right to left, which is what gives
+   the pairing heap its amortized bounds [Fredman 86]. */
+
+static struct heap_elem *meld (const struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (const struct heap *,
+                                      struct heap_elem *first);
+
+/* Returns true if A belongs above B in HEAP: A is larger than B,
+   or they are equal and A was inserted first. */
+static inline bool
+comes_before (const struct heap *heap,
+              const struct heap_elem *a, const struct heap_elem *b)
+{
+  if (heap->less (b, a, heap->aux))
+    return true;
+  else if (heap->less (a, b, heap->aux))
+    return false;
+  else
+    return a->seq < b->seq;
+}
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->elem_cnt = 0;
+  heap->next_seq = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts E into HEAP, after any elements that compare equal to
+   it. */
+void
+heap_insert (struct heap *heap, struct heap_elem *e)
+{
+  ASSERT (heap != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  e->seq = heap->next_seq++;
+  heap->root = meld (heap, heap->root, e);
+  heap->elem_cnt++;
+}
+
+/* Removes E, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *e)
+{
+  ASSERT (heap != NULL);
+  ASSERT (e != NULL);
+  ASSERT (heap->elem_cnt > 0);
+
+  if (e == heap->root)
+    heap->root = merge_pairs (heap, e->child);
+  else
+    {
+      /* Cut E's subtree out of its parent's child list, then meld
+         E's children back into the heap. */
+      if (e->prev->child == e)
+        e->prev->child = e->next;
+      else
+        e->prev->next = e->next;
+      if (e->next != NULL)
+        e->next->prev = e->prev;
+      heap->root = meld (heap, heap->root, merge_pairs (heap, e->child));
+    }
+  heap->elem_cnt--;
+}
+
+/* Removes the largest element from HEAP and returns it.
+   HEAP must not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap)
+{
+  struct heap_elem *top = heap_top (heap);
+
+  heap_remove (heap, top);
+  return top;
+}
+
+/* Restores the heap order after the key of E, which must be in
+   HEAP, has changed.  E keeps its place among elements that
+   compare equal to it. */
+void
+heap_update (struct heap *heap, struct heap_elem *e)
+{
+  uint64_t seq = e->seq;
+
+  heap_remove (heap, e);
+  e->child = e->next = e->prev = NULL;
+  e->seq = seq;
+  heap->root = meld (heap, heap->root, e);
+  heap->elem_cnt++;
+}
+
+/* Returns the largest element in HEAP.  If more than one element
+   is largest, returns the one inserted first.  HEAP must not be
+   empty. */
+struct heap_elem *
+heap_top (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+  ASSERT (heap->root != NULL);
+
+  return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root == NULL;
+}
+
+/* Melds the heaps rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings or parents. */
+static struct heap_elem *
+meld (const struct heap *heap, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (comes_before (heap, b, a))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Melds the list of siblings starting at FIRST into a single
+   heap and returns its root, or a null pointer if FIRST is
+   null. */
+static struct heap_elem *
+merge_pairs (const struct heap *heap, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* First pass: meld siblings in pairs, left to right, stacking
+     the results on PAIRS through their `next' members. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = meld (heap, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass: meld the pairs right to left. */
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
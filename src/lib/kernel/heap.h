@@ -0,0 +1,80 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue (pairing heap).
+
+   A pairing heap keeps its largest element at the root.  Insert
+   and finding the largest element take constant time; removing
+   an element, including the largest, takes O(lg n) amortized
+   time.  That makes it a good fit for wait queues, which are
+   inserted into at every wait but popped only once per wakeup.
+
+   Like the list and hash table implementations, the heap does
+   not use dynamic allocation.  Each structure that can be in a
+   heap must embed a struct heap_elem member, and the heap_entry
+   macro converts a struct heap_elem back into the structure
+   that contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of this technique.
+
+   Elements that compare equal come out of the heap in the order
+   they were inserted.  Each element is stamped with a sequence
+   number on insertion that breaks ties, so the order is stable
+   even though the heap's shape is not.
+
+   If an element's key changes while it is in a heap, call
+   heap_update() to restore the heap order.  The element keeps
+   its original sequence number, so it does not lose its place
+   among equal elements. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* Leftmost child. */
+    struct heap_elem *next;     /* Next sibling to the right. */
+    struct heap_elem *prev;     /* Left sibling, or parent if leftmost. */
+    uint64_t seq;               /* Insertion sequence number. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Largest element, or null if empty. */
+    size_t elem_cnt;            /* Number of elements in heap. */
+    uint64_t next_seq;          /* Sequence number for next insertion. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_insert (struct heap *, struct heap_elem *);
+void heap_remove (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Heap properties. */
+struct heap_elem *heap_top (const struct heap *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,365 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* See rbtree.h for basic information.
+
+   The algorithms are those of [CLRS] chapter 13, except that
+   null pointers stand in for the black leaves instead of a
+   sentinel element, so that the tree code never writes to
+   memory outside the tree's own elements.  rb_remove() tracks
+   the parent of the element that replaces the removed one
+   explicitly, since that element may be null. */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *old,
+                           struct rb_elem *new);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+/* Returns true if E is red.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_elem *e)
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->min = NULL;
+  tree->elem_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts E into TREE, after any elements that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem **link = &tree->root;
+  struct rb_elem *parent = NULL;
+  bool is_min = true;
+
+  ASSERT (tree != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (e, parent, tree->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          is_min = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (is_min)
+    tree->min = e;
+  tree->elem_cnt++;
+
+  insert_fixup (tree, e);
+}
+
+/* Removes E, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *x;            /* Element that moves into the gap. */
+  struct rb_elem *x_parent;     /* Parent of X after the removal. */
+  bool removed_red;             /* Color of the element unlinked. */
+
+  ASSERT (tree != NULL);
+  ASSERT (e != NULL);
+  ASSERT (tree->elem_cnt > 0);
+
+  if (tree->min == e)
+    tree->min = rb_next (e);
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      x = e->left != NULL ? e->left : e->right;
+      x_parent = e->parent;
+      removed_red = e->red;
+      replace_child (tree, e, x);
+    }
+  else
+    {
+      /* E has two children.  Its successor Y, which has no left
+         child, takes its place, and Y's right child takes Y's. */
+      struct rb_elem *y = e->right;
+      while (y->left != NULL)
+        y = y->left;
+
+      removed_red = y->red;
+      x = y->right;
+      if (y->parent == e)
+        x_parent = y;
+      else
+        {
+          x_parent = y->parent;
+          replace_child (tree, y, x);
+          y->right = e->right;
+          y->right->parent = y;
+        }
+      replace_child (tree, e, y);
+      y->left = e->left;
+      y->left->parent = y;
+      y->red = e->red;
+    }
+  tree->elem_cnt--;
+
+  if (!removed_red)
+    remove_fixup (tree, x, x_parent);
+}
+
+/* Returns the minimum element in TREE, or a null pointer if
+   TREE is empty.  Takes constant time. */
+struct rb_elem *
+rb_min (const struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+  return tree->min;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the maximum element. */
+struct rb_elem *
+rb_next (struct rb_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+  else
+    {
+      while (e->parent != NULL && e == e->parent->right)
+        e = e->parent;
+      return e->parent;
+    }
+}
+
+/* Returns the number of elements in TREE. */
+size_t
+rb_size (const struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+  return tree->elem_cnt;
+}
+
+/* Returns true if TREE contains no elements, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree)
+{
+  ASSERT (tree != NULL);
+  return tree->root == NULL;
+}
+
+/* Makes NEW take OLD's place as a child of OLD's parent, or as
+   the root of TREE if OLD is the root.  NEW may be null.  Does
+   not modify OLD. */
+static void
+replace_child (struct rb_tree *tree, struct rb_elem *old, struct rb_elem *new)
+{
+  struct rb_elem *parent = old->parent;
+
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+  if (new != NULL)
+    new->parent = parent;
+}
+
+/* Rotates the subtree rooted at E to the left, so that E's
+   right child takes E's place and E becomes its left child. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  replace_child (tree, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, so that E's left
+   child takes E's place and E becomes its right child. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  replace_child (tree, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties of TREE after E, which is
+   red, has been inserted as a leaf. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_elem *e)
+{
+  struct rb_elem *parent;
+
+  while ((parent = e->parent) != NULL && parent->red)
+    {
+      /* PARENT is red, so it is not the root. */
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->right)
+                {
+                  rotate_left (tree, parent);
+                  e = parent;
+                  parent = e->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_right (tree, grandparent);
+            }
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+          if (is_red (uncle))
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+            }
+          else
+            {
+              if (e == parent->left)
+                {
+                  rotate_right (tree, parent);
+                  e = parent;
+                  parent = e->parent;
+                }
+              parent->red = false;
+              grandparent->red = true;
+              rotate_left (tree, grandparent);
+            }
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties of TREE after a black
+   element was removed.  X, which may be null, is the element
+   that took its place, and PARENT is X's parent.  The subtree
+   rooted at X has one fewer black element on each path than its
+   sibling subtree. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_elem *x, struct rb_elem *parent)
+{
+  while (x != tree->root && !is_red (x))
+    {
+      /* X's sibling W exists, because its subtree has at least
+         one black element on every path. */
+      if (x == parent->left)
+        {
+          struct rb_elem *w = parent->right;
+          if (w->red)
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->right))
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (tree, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (tree, parent);
+              x = tree->root;
+            }
+        }
+      else
+        {
+          struct rb_elem *w = parent->left;
+          if (w->red)
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else
+            {
+              if (!is_red (w->left))
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (tree, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (tree, parent);
+              x = tree->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
@@ -0,0 +1,75 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a balanced binary search tree: insertion
+   and removal take O(lg n) time in the worst case.  This
+   implementation also caches a pointer to the tree's minimum
+   element, so that rb_min() takes constant time, which suits
+   priority-queue-like uses such as a scheduler's run queue.
+
+   Like the list and hash table implementations, the tree does
+   not use dynamic allocation.  Each structure that can be in a
+   tree must embed a struct rb_elem member, and the rb_entry
+   macro converts a struct rb_elem back into the structure that
+   contains it.  Refer to lib/kernel/list.h for a detailed
+   explanation of this technique.
+
+   Elements that compare equal are allowed.  An element inserted
+   into a tree goes after every element that compares equal to
+   it, so equal elements come out of the tree in FIFO order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree element. */
+struct rb_elem
+  {
+    struct rb_elem *parent;     /* Parent, or null for the root. */
+    struct rb_elem *left;       /* Left child. */
+    struct rb_elem *right;      /* Right child. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree element RB_ELEM into a pointer to
+   the structure that RB_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/* Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_elem *root;       /* Root, or null if tree is empty. */
+    struct rb_elem *min;        /* Minimum element, or null. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+
+/* Tree traversal, in ascending order. */
+struct rb_elem *rb_min (const struct rb_tree *);
+struct rb_elem *rb_next (struct rb_elem *);
+
+/* Tree properties. */
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,64 @@
+#ifndef __LIB_STATS_H
+#define __LIB_STATS_H
+
+#include <stdint.h>
+
+/* Statistics that the kernel exports to user programs through
+   system calls.  Shared between the kernel and user programs. */
+
+/* Scheduling statistics for one thread.  Times are in timer
+   ticks. */
+struct thread_stats
+  {
+    int64_t run_ticks;          /* Ticks spent running. */
+    int64_t ready_ticks;        /* Ticks spent ready, waiting for CPU. */
+    int64_t blocked_ticks;      /* Ticks spent blocked. */
+    uint32_t voluntary_switches;   /* Switches away by blocking or yield. */
+    uint32_t involuntary_switches; /* Switches away by preemption. */
+    int last_cpu;               /* CPU the thread last ran on. */
+    uint32_t edf_jobs;          /* EDF jobs completed. */
+    uint32_t edf_misses;        /* EDF jobs completed past deadline. */
+  };
+
+/* Number of buckets in a block device latency histogram.
+   Bucket 0 counts requests that took less than 2 microseconds
+   and bucket I > 0 those that took from 2**I to 2**(I+1) - 1
+   microseconds, except that the last bucket also counts every
+   longer request. */
+#define BLOCK_LATENCY_BUCKETS 24
+
+/* Number of buckets in a block device queue depth histogram,
+   bucketed the same way: 1, 2...3, 4...7, and so on. */
+#define BLOCK_DEPTH_BUCKETS 8
+
+/* Statistics for one direction of transfer on a block device.
+   A request is sequential if it starts at the sector after the
+   previous request submitted to the device ended, in either
+   direction. */
+struct block_xfer_stats
+  {
+    uint64_t requests;          /* Requests completed. */
+    uint64_t bytes;             /* Bytes transferred. */
+    uint64_t commands;          /* Device commands, if driver counts. */
+    uint64_t sequential;        /* Sequential requests submitted. */
+    uint64_t random;            /* Other requests submitted. */
+    uint64_t total_ns;          /* Sum of latencies, in nanoseconds. */
+    uint32_t latency[BLOCK_LATENCY_BUCKETS]; /* Latencies in log2 us. */
+  };
+
+/* I/O statistics for one block device.  A request's latency runs
+   from its submission to its completion, so it includes time
+   spent waiting in the device's queue.  The queue depth is
+   sampled as each request arrives, counting the request itself
+   and any in progress. */
+struct block_stats
+  {
+    char name[16];              /* Device name, e.g. "hdb1". */
+    struct block_xfer_stats read;   /* Reads. */
+    struct block_xfer_stats write;  /* Writes. */
+    uint32_t depth[BLOCK_DEPTH_BUCKETS]; /* Queue depths in log2. */
+    uint64_t depth_total;       /* Sum of queue depth samples. */
+    uint32_t depth_max;         /* Greatest queue depth sampled. */
+  };
+
+#endif /* lib/stats.h */
@@ -28,7 +28,13 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions.  New calls go at the end, so that existing
+       numbers never change. */
+    SYS_SCHEDSTATS,             /* Obtain a process's scheduling stats. */
+    SYS_CLOCK,                  /* Read the high-resolution clock. */
+    SYS_BLOCKSTATS              /* Obtain a block device's I/O stats. */
   };
 
 #endif /* lib/syscall-nr.h */
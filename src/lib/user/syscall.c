@@ -182,3 +182,23 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+schedstats (pid_t pid, struct thread_stats *stats)
+{
+  return syscall2 (SYS_SCHEDSTATS, pid, stats);
+}
+
+bool
+blockstats (int dev, struct block_stats *stats)
+{
+  return syscall2 (SYS_BLOCKSTATS, dev, stats);
+}
+
+int64_t
+clock_ns (void)
+{
+  int64_t ns;
+  syscall1 (SYS_CLOCK, &ns);
+  return ns;
+}
@@ -2,7 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,11 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Statistics. */
+bool schedstats (pid_t, struct thread_stats *);
+bool blockstats (int dev, struct block_stats *);
+
+/* Time. */
+int64_t clock_ns (void);
+
 #endif /* lib/user/syscall.h */
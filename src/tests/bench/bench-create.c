@@ -0,0 +1,49 @@
+/* Measures creating a thread and waiting for it to exit.  The
+   child runs at a higher priority, so thread_create() switches
+   to it right away; it ups a semaphore and exits, and the parent
+   downs the semaphore. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define OP_CNT 1000
+
+static bench_func create_join;
+static thread_func child;
+
+void
+test_bench_create (void)
+{
+  ASSERT (!thread_mlfqs);
+
+  bench_run ("thread-create-join", create_join, OP_CNT, NULL);
+}
+
+/* Creates and joins OPS threads, one at a time. */
+static uint64_t
+create_join (int ops, void *aux UNUSED)
+{
+  struct semaphore done;
+  uint64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  start = timer_cycles ();
+  for (i = 0; i < ops; i++)
+    {
+      if (thread_create ("child", thread_get_priority () + 1, child, &done)
+          == TID_ERROR)
+        fail ("thread_create failed");
+      sema_down (&done);
+    }
+  return timer_cycles () - start;
+}
+
+static void
+child (void *done)
+{
+  sema_up (done);
+}
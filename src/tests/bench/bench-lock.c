@@ -0,0 +1,99 @@
+/* Measures lock_acquire() and lock_release() without contention
+   and a contended lock handoff.  In the handoff benchmark,
+   several threads of equal priority each repeatedly acquire the
+   lock, yield while holding it so that the others queue up
+   behind it, release it, and yield again so that the thread the
+   release woke takes the lock before the releaser can come back
+   for it.  Every acquisition after the first thus blocks and is
+   woken by a release.  The reported cost includes the yields. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define OP_CNT 10000            /* Uncontended acquire-release pairs. */
+#define HANDOFF_CNT 1000        /* Handoffs per contending thread. */
+#define CONTENDER_CNT 4         /* Contending threads. */
+
+/* Shared state for the handoff benchmark. */
+struct handoff
+  {
+    struct lock lock;           /* Lock handed off. */
+    int ops;                    /* Acquisitions per thread. */
+    struct semaphore done;      /* Upped by each thread when done. */
+  };
+
+static bench_func lock_uncontended;
+static bench_func lock_handoff;
+static thread_func contender;
+
+void
+test_bench_lock (void)
+{
+  ASSERT (!thread_mlfqs);
+
+  bench_run ("lock-uncontended", lock_uncontended, OP_CNT, NULL);
+  bench_run ("lock-handoff", lock_handoff, HANDOFF_CNT * CONTENDER_CNT,
+             NULL);
+}
+
+/* Acquires and releases a free lock OPS times. */
+static uint64_t
+lock_uncontended (int ops, void *aux UNUSED)
+{
+  struct lock lock;
+  uint64_t start;
+  int i;
+
+  lock_init (&lock);
+  start = timer_cycles ();
+  for (i = 0; i < ops; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  return timer_cycles () - start;
+}
+
+/* Hands a lock off between CONTENDER_CNT threads OPS times in
+   all. */
+static uint64_t
+lock_handoff (int ops, void *aux UNUSED)
+{
+  struct handoff h;
+  uint64_t start;
+  int i;
+
+  lock_init (&h.lock);
+  h.ops = ops / CONTENDER_CNT;
+  sema_init (&h.done, 0);
+
+  /* Hold the lock until every contender is queued on it. */
+  lock_acquire (&h.lock);
+  for (i = 0; i < CONTENDER_CNT; i++)
+    thread_create ("contender", thread_get_priority () + 1, contender, &h);
+
+  start = timer_cycles ();
+  lock_release (&h.lock);
+  for (i = 0; i < CONTENDER_CNT; i++)
+    sema_down (&h.done);
+  return timer_cycles () - start;
+}
+
+static void
+contender (void *h_)
+{
+  struct handoff *h = h_;
+  int i;
+
+  for (i = 0; i < h->ops; i++)
+    {
+      lock_acquire (&h->lock);
+      thread_yield ();
+      lock_release (&h->lock);
+      thread_yield ();
+    }
+  sema_up (&h->done);
+}
@@ -0,0 +1,43 @@
+/* Measures console output throughput: the cycles per byte to
+   print lines with printf() and get them all out the serial
+   port, which is what limits how fast a chatty test can run.
+
+   Each run prints OP_CNT bytes as lines of filler text and then
+   flushes the serial transmit queue, so the time includes
+   draining the queue to the hardware, not just filling it. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/serial.h"
+
+#define OP_CNT 2048
+
+/* A line of output, LINE_LEN bytes including the new-line. */
+static const char line[] =
+  "printf throughput filler, 64 bytes per line....................\n";
+#define LINE_LEN (sizeof line - 1)
+
+static bench_func print_lines;
+
+void
+test_bench_printf (void)
+{
+  ASSERT (OP_CNT % LINE_LEN == 0);
+
+  bench_run ("printf", print_lines, OP_CNT, NULL);
+}
+
+/* Prints OPS bytes of output and waits for it to leave the
+   serial port. */
+static uint64_t
+print_lines (int ops, void *aux UNUSED)
+{
+  uint64_t start = timer_cycles ();
+  int i;
+
+  for (i = 0; i < ops; i += LINE_LEN)
+    printf ("%s", line);
+  serial_flush ();
+  return timer_cycles () - start;
+}
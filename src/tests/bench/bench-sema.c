@@ -0,0 +1,66 @@
+/* Measures a semaphore ping-pong between two threads of equal
+   priority: each round trip is a sema_up() and sema_down() by
+   each thread and two context switches. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define OP_CNT 10000
+
+/* Semaphores for the ping-pong. */
+struct pingpong
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+    int ops;
+  };
+
+static bench_func sema_pingpong;
+static thread_func pong_thread;
+
+void
+test_bench_sema (void)
+{
+  ASSERT (!thread_mlfqs);
+
+  bench_run ("sema-pingpong", sema_pingpong, OP_CNT, NULL);
+}
+
+/* Bounces OPS round trips off a partner thread. */
+static uint64_t
+sema_pingpong (int ops, void *aux UNUSED)
+{
+  struct pingpong pp;
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  pp.ops = ops;
+  thread_create ("pong", thread_get_priority (), pong_thread, &pp);
+
+  start = timer_cycles ();
+  for (i = 0; i < ops; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  cycles = timer_cycles () - start;
+  return cycles;
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < pp->ops; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
@@ -0,0 +1,71 @@
+/* Measures the latency from a timer interrupt to a thread that
+   it wakes starting to run.
+
+   A low-priority thread spins, recording the time-stamp counter
+   on every iteration, while the main thread sleeps until the
+   next tick.  When the tick arrives, the woken main thread
+   preempts the spinner, so the spinner's last recorded time is
+   within one loop iteration of the interrupt, and the main
+   thread's first reading of the time-stamp counter after waking
+   gives the latency. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define OP_CNT 100
+
+/* Shared with the spinner. */
+struct spin
+  {
+    volatile uint64_t last_tsc; /* Spinner's most recent reading. */
+    volatile bool stop;         /* Tells the spinner to exit. */
+  };
+
+static bench_func timer_wakeup;
+static thread_func spinner;
+
+void
+test_bench_wakeup (void)
+{
+  ASSERT (!thread_mlfqs);
+
+  bench_run ("timer-wakeup", timer_wakeup, OP_CNT, NULL);
+}
+
+/* Sleeps until each of the next OPS ticks, and returns the total
+   latency between the spinner's last reading and our waking. */
+static uint64_t
+timer_wakeup (int ops, void *aux UNUSED)
+{
+  struct spin s;
+  uint64_t total = 0;
+  int i;
+
+  s.last_tsc = 0;
+  s.stop = false;
+  thread_create ("spinner", PRI_MIN, spinner, &s);
+  timer_sleep (1);
+
+  for (i = 0; i < ops; i++)
+    {
+      timer_sleep_until (timer_ticks () + 1);
+      total += timer_cycles () - s.last_tsc;
+    }
+
+  /* Let the spinner exit. */
+  s.stop = true;
+  timer_sleep (1);
+  return total;
+}
+
+static void
+spinner (void *s_)
+{
+  struct spin *s = s_;
+
+  while (!s->stop)
+    s->last_tsc = timer_cycles ();
+}
@@ -0,0 +1,71 @@
+/* Measures thread_yield() when no other thread is ready, which
+   goes through schedule() without switching threads, and the
+   round trip of two equal-priority threads yielding to each
+   other, which costs two calls to switch_threads().  The
+   difference between the two approximates the cost of a context
+   switch. */
+
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define OP_CNT 10000
+
+static bench_func yield_self;
+static bench_func yield_roundtrip;
+static thread_func yield_partner;
+
+void
+test_bench_yield (void)
+{
+  ASSERT (!thread_mlfqs);
+
+  bench_run ("yield-self", yield_self, OP_CNT, NULL);
+  bench_run ("yield-roundtrip", yield_roundtrip, OP_CNT, NULL);
+}
+
+/* Yields OPS times with no other thread ready. */
+static uint64_t
+yield_self (int ops, void *aux UNUSED)
+{
+  uint64_t start = timer_cycles ();
+  int i;
+
+  for (i = 0; i < ops; i++)
+    thread_yield ();
+  return timer_cycles () - start;
+}
+
+/* Yields OPS times to a partner thread that yields back. */
+static uint64_t
+yield_roundtrip (int ops, void *aux UNUSED)
+{
+  volatile bool stop = false;
+  uint64_t start, cycles;
+  int i;
+
+  thread_create ("partner", thread_get_priority (), yield_partner,
+                 (void *) &stop);
+  thread_yield ();
+
+  start = timer_cycles ();
+  for (i = 0; i < ops; i++)
+    thread_yield ();
+  cycles = timer_cycles () - start;
+
+  /* Let the partner see STOP and exit. */
+  stop = true;
+  thread_yield ();
+  return cycles;
+}
+
+static void
+yield_partner (void *stop_)
+{
+  volatile bool *stop = stop_;
+
+  while (!*stop)
+    thread_yield ();
+}
@@ -0,0 +1,34 @@
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/thread.h"
+
+/* Number of times each benchmark is run. */
+#define RUN_CNT 5
+
+/* Runs FUNC with OPS and AUX RUN_CNT times after one warm-up run
+   and reports the cycles per operation as METRIC. */
+void
+bench_run (const char *metric, bench_func *func, int ops, void *aux)
+{
+  uint64_t min = UINT64_MAX, total = 0;
+  int run;
+
+  ASSERT (ops > 0);
+
+  /* Warm up caches and, for benchmarks that create threads, the
+     thread page cache. */
+  func (ops, aux);
+
+  for (run = 0; run < RUN_CNT; run++)
+    {
+      uint64_t cycles = func (ops, aux);
+
+      total += cycles;
+      if (cycles < min)
+        min = cycles;
+    }
+
+  msg ("BENCH metric=%s min=%llu avg=%llu unit=cycles/op ops=%d runs=%d",
+       metric, min / ops, total / RUN_CNT / ops, ops, RUN_CNT);
+}
@@ -0,0 +1,33 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stdint.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+/* Kernel microbenchmarks.
+
+   Each benchmark times some number of operations with the CPU's
+   time-stamp counter, several runs in a row, and reports the
+   cycles per operation of the fastest run and the average over
+   all runs on a single line of the form
+
+        (bench-NAME) BENCH metric=M min=N avg=N unit=cycles/op ops=N runs=N
+
+   tests/bench/bench.pm parses these lines and can compare them
+   against a saved baseline to catch regressions. */
+
+/* Performs OPS operations, given auxiliary data AUX, and returns
+   the number of cycles they took. */
+typedef uint64_t bench_func (int ops, void *aux);
+
+void bench_run (const char *metric, bench_func *, int ops, void *aux);
+
+extern test_func test_bench_yield;
+extern test_func test_bench_sema;
+extern test_func test_bench_lock;
+extern test_func test_bench_create;
+extern test_func test_bench_wakeup;
+extern test_func test_bench_printf;
+
+#endif /* tests/bench/bench.h */
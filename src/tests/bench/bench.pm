@@ -0,0 +1,47 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Returns a hash from metric name to minimum cycles per operation
+# for the BENCH lines in @LINES.
+sub parse_bench {
+    my (%min);
+    foreach (@_) {
+	my ($metric, $min) = /BENCH metric=(\S+) min=(\d+)/ or next;
+	$min{$metric} = $min;
+    }
+    return %min;
+}
+
+# Checks that the test's output reports each of the given metrics.
+#
+# If the environment variable BENCH_BASELINE names a file, such as
+# the concatenated .output files of an earlier run, also fails if
+# any metric is more than BENCH_TOLERANCE percent (default 25)
+# slower than the same metric in that file.
+sub check_bench {
+    my (@metrics) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (%min) = parse_bench (@output);
+    foreach my $metric (@metrics) {
+	fail "missing result for $metric\n" if !defined $min{$metric};
+    }
+
+    if (defined $ENV{BENCH_BASELINE}) {
+	my (%base) = parse_bench (read_text_file ($ENV{BENCH_BASELINE}));
+	my ($tolerance) = $ENV{BENCH_TOLERANCE} || 25;
+	foreach my $metric (@metrics) {
+	    next if !defined $base{$metric};
+	    fail "$metric regressed: $min{$metric} cycles/op, "
+	      . "baseline $base{$metric}\n"
+	      if $min{$metric} > $base{$metric} * (1 + $tolerance / 100);
+	}
+    }
+    pass;
+}
+
+1;
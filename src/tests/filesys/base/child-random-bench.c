@@ -0,0 +1,43 @@
+/* Child process for random-bench test.
+   Reads READ_CNT sectors of the test file at random offsets,
+   checking that each holds the low byte of its sector number. */
+
+#include <random.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/random-bench.h"
+
+static char buf[BLOCK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int fd, i;
+
+  test_name = "child-random-bench";
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  random_init (child_idx);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < READ_CNT; i++)
+    {
+      int sector = random_ulong () % (FILE_SIZE / BLOCK_SIZE);
+      int j;
+
+      seek (fd, sector * BLOCK_SIZE);
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %d failed",
+              BLOCK_SIZE, sector * BLOCK_SIZE);
+      for (j = 0; j < BLOCK_SIZE; j++)
+        if (buf[j] != (char) sector)
+          fail ("wrong data read at offset %d", sector * BLOCK_SIZE + j);
+    }
+  close (fd);
+
+  return child_idx;
+}
@@ -0,0 +1,8 @@
+/* Writes out a small file sequentially on a file system that
+   the kernel formats on RAM disk ram0, given the -ramdisk and
+   -filesys=ram0 options, then reads it back to verify that it
+   was written properly. */
+
+#define TEST_SIZE 5678
+#define BLOCK_SIZE 513
+#include "tests/filesys/base/seq-block.inc"
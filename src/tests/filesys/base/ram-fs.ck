@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+fail "file system was not on ram0\n"
+  if !grep (/^filesys: using ram0$/, read_text_file ("$test.output"));
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ram-fs) begin
+(ram-fs) create "noodle"
+(ram-fs) open "noodle"
+(ram-fs) writing "noodle"
+(ram-fs) close "noodle"
+(ram-fs) open "noodle" for verification
+(ram-fs) verified contents of "noodle"
+(ram-fs) close "noodle"
+(ram-fs) end
+EOF
+pass;
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "kernel did not run with -fifo\n"
+  if !grep (/^Kernel command line:.* -fifo /, @output);
+
+@output = get_core_output ("run", @output);
+
+fail "missing random read rate\n"
+  if !grep (/random read: \d+ kB\/s/, @output);
+fail "random-bench-fifo did not exit normally\n"
+  if !grep (/^random-bench-fifo: exit\(0\)$/, @output);
+pass;
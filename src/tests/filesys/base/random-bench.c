@@ -0,0 +1,50 @@
+/* Measures random-read throughput under concurrency: fills a
+   file, then spawns several child processes that each read
+   sectors of it at random offsets at the same time, and reports
+   the total rate in kB/s as measured by clock_ns().  With
+   several processes waiting on the disk, the block layer's
+   queue holds several requests, so compare a normal run against
+   random-bench-fifo, which runs this same program with the
+   kernel's -fifo option, to see what C-LOOK ordering gains. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/random-bench.h"
+
+#define CHILD_CNT 4
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int64_t start, ns, us;
+  int fd, ofs;
+
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      size_t i;
+
+      /* Fill each sector with the low byte of its number, for the
+         children to check. */
+      for (i = 0; i < sizeof buf; i++)
+        buf[i] = (ofs + i) / BLOCK_SIZE;
+      if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+        fail ("write %zu bytes at offset %d failed", sizeof buf, ofs);
+    }
+  close (fd);
+
+  start = clock_ns ();
+  exec_children ("child-random-bench", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  ns = clock_ns () - start;
+
+  us = ns / 1000 > 0 ? ns / 1000 : 1;
+  msg ("random read: %d kB/s",
+       (int) ((int64_t) CHILD_CNT * READ_CNT * BLOCK_SIZE
+              * 1000 * 1000 / 1024 / us));
+}
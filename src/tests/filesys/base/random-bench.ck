@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing random read rate\n"
+  if !grep (/random read: \d+ kB\/s/, @output);
+fail "random-bench did not exit normally\n"
+  if !grep (/^random-bench: exit\(0\)$/, @output);
+pass;
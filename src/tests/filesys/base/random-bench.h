@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_BASE_RANDOM_BENCH_H
+#define TESTS_FILESYS_BASE_RANDOM_BENCH_H
+
+#define FILE_SIZE (256 * 1024)
+#define BLOCK_SIZE 512
+#define READ_CNT 64
+static const char file_name[] = "bench";
+
+#endif /* tests/filesys/base/random-bench.h */
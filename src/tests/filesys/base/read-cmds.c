@@ -0,0 +1,52 @@
+/* Reads a 64 kB file with a single read() and reports how many
+   commands the disk driver issued for it.  With multi-sector
+   transfers that is far fewer than the file's 128 sectors.  Runs
+   with the kernel's -pio option, so that the IDE driver uses
+   READ MULTIPLE rather than DMA. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024)
+
+static char buf[FILE_SIZE];
+static char expected[FILE_SIZE];
+
+/* Returns the number of read commands that block device drivers
+   have issued. */
+static uint64_t
+read_commands (void)
+{
+  struct block_stats stats;
+  uint64_t commands = 0;
+  int dev;
+
+  for (dev = 0; blockstats (dev, &stats); dev++)
+    commands += stats.read.commands;
+  return commands;
+}
+
+void
+test_main (void) 
+{
+  uint64_t before, commands;
+  int fd;
+
+  random_bytes (expected, sizeof expected);
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (write (fd, expected, FILE_SIZE) == FILE_SIZE, "write \"data\"");
+  seek (fd, 0);
+
+  before = read_commands ();
+  CHECK (read (fd, buf, FILE_SIZE) == FILE_SIZE, "read \"data\"");
+  commands = read_commands () - before;
+  close (fd);
+
+  if (memcmp (buf, expected, FILE_SIZE))
+    fail ("wrong data read");
+  msg ("read 64 kB with %d commands", (int) commands);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "IDE disk did not enter multiple mode\n"
+  if !grep (/^hd[a-d]: .*PIO multiple/, @output);
+
+@output = get_core_output ("run", @output);
+
+my ($commands) = map (/read 64 kB with (\d+) commands/, @output);
+fail "missing command count\n" if !defined $commands;
+fail "reading 64 kB took $commands commands, not fewer than 128\n"
+  if $commands >= 128;
+fail "read-cmds did not exit normally\n"
+  if !grep (/^read-cmds: exit\(0\)$/, @output);
+pass;
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "no virtio-blk disk vda\n" if !grep (/^vda: /, @output);
+fail "file system was not on vda\n"
+  if !grep (/^filesys: using vda/, @output);
+@output = get_core_output ("run", @output);
+
+fail "missing sequential write rate\n"
+  if !grep (/sequential write: \d+ kB\/s/, @output);
+fail "missing sequential read rate\n"
+  if !grep (/sequential read: \d+ kB\/s/, @output);
+fail "seq-bench-virtio did not exit normally\n"
+  if !grep (/^seq-bench-virtio: exit\(0\)$/, @output);
+pass;
@@ -0,0 +1,72 @@
+/* Measures sequential file throughput: writes a file several
+   times over in fixed-size blocks, then reads it back as many
+   times, and reports the rate of each in kB/s as measured by
+   clock_ns().  The file system has no cache, so each byte goes
+   to or from the disk, and the rates show how fast the disk
+   driver moves data: compare a normal run against one with the
+   kernel's -pio option to see the effect of DMA, against
+   seq-bench-virtio, which runs this same program with the disk
+   attached through virtio-blk instead of IDE, or against
+   seq-bench-ram, which runs it on a RAM disk to show the cost of
+   the file system alone. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024)
+#define BLOCK_SIZE 4096
+#define ROUND_CNT 4
+
+static char buf[BLOCK_SIZE];
+static char expected[BLOCK_SIZE];
+
+/* Returns the rate, in kB/s, of moving ROUND_CNT * FILE_SIZE
+   bytes in NS nanoseconds. */
+static int
+rate (int64_t ns)
+{
+  int64_t us = ns / 1000 > 0 ? ns / 1000 : 1;
+  return (int64_t) ROUND_CNT * FILE_SIZE * 1000 * 1000 / 1024 / us;
+}
+
+void
+test_main (void) 
+{
+  int64_t start, write_ns, read_ns;
+  int fd, round, ofs;
+
+  random_bytes (expected, sizeof expected);
+  CHECK (create ("bench", FILE_SIZE), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+
+  start = clock_ns ();
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        if (write (fd, expected, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("write %d bytes at offset %d failed", BLOCK_SIZE, ofs);
+    }
+  write_ns = clock_ns () - start;
+
+  start = clock_ns ();
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        {
+          if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+            fail ("read %d bytes at offset %d failed", BLOCK_SIZE, ofs);
+          if (memcmp (buf, expected, BLOCK_SIZE))
+            fail ("wrong data read at offset %d", ofs);
+        }
+    }
+  read_ns = clock_ns () - start;
+  close (fd);
+
+  msg ("sequential write: %d kB/s", rate (write_ns));
+  msg ("sequential read: %d kB/s", rate (read_ns));
+}
@@ -0,0 +1,142 @@
+/* Puts 1000 threads to sleep at once, with deadlines spread
+   over a few ticks, and measures two things: how many threads
+   sit in the run queue while the sleepers are asleep, and how
+   many ticks late each sleeper runs after its deadline.
+
+   With sleepers blocked on the timer's wakeup queue, the run
+   queue should stay empty while they sleep and each sleeper
+   should run on (or very near) the tick it asked for. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 1000        /* Number of sleeping threads. */
+#define DEADLINE_SPREAD 25      /* Number of distinct deadlines. */
+#define SAMPLE_TICKS 20         /* Ticks to sample the run queue. */
+
+/* Information about the test. */
+struct bench_test
+  {
+    int64_t start;              /* Base of all sleepers' deadlines. */
+    int asleep_cnt;             /* Sleepers about to sleep. */
+    int woken_cnt;              /* Sleepers that have woken up. */
+    int64_t total_latency;      /* Sum of wakeup latencies, in ticks. */
+    int64_t max_latency;        /* Largest wakeup latency, in ticks. */
+    int early_cnt;              /* Sleepers woken before deadline. */
+    struct semaphore done;      /* Upped by each sleeper when done. */
+  };
+
+/* Information about an individual sleeper. */
+struct bench_sleeper
+  {
+    struct bench_test *test;    /* Info shared between all threads. */
+    int64_t deadline;           /* Tick to wake up at. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_bench (void)
+{
+  struct bench_test test;
+  struct bench_sleeper *sleepers;
+  int ready_max, ready_total;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sleepers = malloc (sizeof *sleepers * SLEEPER_CNT);
+  if (sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  test.start = timer_ticks () + 200;
+  test.asleep_cnt = 0;
+  test.woken_cnt = 0;
+  test.total_latency = 0;
+  test.max_latency = 0;
+  test.early_cnt = 0;
+  sema_init (&test.done, 0);
+
+  msg ("Creating %d sleepers with %d distinct deadlines.",
+       SLEEPER_CNT, DEADLINE_SPREAD);
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      struct bench_sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->test = &test;
+      s->deadline = test.start + i % DEADLINE_SPREAD;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, s) == TID_ERROR)
+        fail ("couldn't create sleeper %d", i);
+    }
+
+  /* Wait for every sleeper to go to sleep. */
+  while (test.asleep_cnt < SLEEPER_CNT)
+    timer_sleep (1);
+  timer_sleep (1);
+  if (timer_ticks () + SAMPLE_TICKS >= test.start)
+    fail ("sleepers took too long to fall asleep");
+
+  /* Sample the run queue while everyone sleeps. */
+  ready_max = ready_total = 0;
+  for (i = 0; i < SAMPLE_TICKS; i++)
+    {
+      int ready = thread_ready_count ();
+      if (ready > ready_max)
+        ready_max = ready;
+      ready_total += ready;
+      timer_sleep (1);
+    }
+
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&test.done);
+
+  msg ("Run queue while sleeping: max %d, average %d.%02d threads.",
+       ready_max, ready_total / SAMPLE_TICKS,
+       ready_total * 100 / SAMPLE_TICKS % 100);
+  msg ("Sleepers woken: %d, early: %d.", test.woken_cnt, test.early_cnt);
+  msg ("Wakeup latency: max %lld, average %lld.%02lld ticks.",
+       test.max_latency, test.total_latency / SLEEPER_CNT,
+       test.total_latency * 100 / SLEEPER_CNT % 100);
+
+  free (sleepers);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *s_)
+{
+  struct bench_sleeper *s = s_;
+  struct bench_test *test = s->test;
+  enum intr_level old_level;
+  int64_t latency;
+
+  old_level = intr_disable ();
+  test->asleep_cnt++;
+  intr_set_level (old_level);
+
+  timer_sleep (s->deadline - timer_ticks ());
+  latency = timer_ticks () - s->deadline;
+
+  old_level = intr_disable ();
+  test->woken_cnt++;
+  if (latency < 0)
+    test->early_cnt++;
+  else
+    {
+      test->total_latency += latency;
+      if (latency > test->max_latency)
+        test->max_latency = latency;
+    }
+  intr_set_level (old_level);
+
+  sema_up (&test->done);
+}
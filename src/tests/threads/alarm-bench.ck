@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($ready_max, $woken, $early, $latency_max);
+foreach (@output) {
+    ($ready_max) = /Run queue while sleeping: max (\d+)/ if !defined $ready_max;
+    ($woken, $early) = /Sleepers woken: (\d+), early: (\d+)/
+      if !defined $woken;
+    ($latency_max) = /Wakeup latency: max (\d+)/ if !defined $latency_max;
+}
+fail "missing run queue statistics\n" if !defined $ready_max;
+fail "missing wakeup statistics\n" if !defined $woken || !defined $latency_max;
+fail "only $woken of 1000 sleepers woke up\n" if $woken != 1000;
+fail "$early sleepers woke up before their deadline\n" if $early;
+fail "$ready_max threads in run queue while sleeping\n" if $ready_max > 10;
+pass;
@@ -0,0 +1,48 @@
+/* Checks that tickless idle keeps timer_ticks() in step with
+   real time.  Sleeps many times across several one-shot
+   countdowns each, starting each sleep partway through a tick
+   and printing while asleep so that serial interrupts wake the
+   CPU early, then compares the ticks counted with the time-stamp
+   counter's nanoseconds. */
+
+#include <stdio.h>
+#include <debug.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeps, and ticks per sleep.  Each sleep is longer
+   than the longest one-shot countdown. */
+#define SLEEP_CNT 20
+#define SLEEP_TICKS 12
+
+void
+test_alarm_tickless (void) 
+{
+  int64_t tick_ns = 1000 * 1000 * 1000 / TIMER_FREQ;
+  int64_t start_ticks, start_ns, ticks_ns, elapsed_ns, drift;
+  int i;
+
+  ASSERT (timer_tickless);
+
+  timer_sleep (1);
+  start_ticks = timer_ticks ();
+  start_ns = timer_ns ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      timer_udelay (1000 * 1000 / TIMER_FREQ / 2);
+      msg ("Sleep %d.", i);
+      timer_sleep (SLEEP_TICKS);
+    }
+  ticks_ns = (timer_ticks () - start_ticks) * tick_ns;
+  elapsed_ns = timer_ns () - start_ns;
+
+  drift = ticks_ns - elapsed_ns;
+  if (drift < 0)
+    drift = -drift;
+  if (drift >= tick_ns)
+    fail ("%lld ticks counted over %lld ns, %lld ns apart",
+          (ticks_ns / tick_ns), elapsed_ns, drift);
+  msg ("timer_ticks() kept within a tick of real time.");
+}
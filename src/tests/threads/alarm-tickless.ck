@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "kernel did not run with -tickless\n"
+  if !grep (/^Kernel command line:.* -tickless /, @output);
+
+@output = get_core_output ("run", @output);
+
+fail "missing drift check\n"
+  if !grep (/^\(alarm-tickless\) timer_ticks\(\) kept within a tick/, @output);
+pass;
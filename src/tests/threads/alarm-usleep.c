@@ -0,0 +1,35 @@
+/* Checks that timer_usleep() sleeps at least as long as asked,
+   and that sleeps shorter than a tick do not round up to a whole
+   tick now that they are timed with the TSC. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static const int64_t sleep_us[] = {10, 100, 1000, 5000};
+
+void
+test_alarm_usleep (void) 
+{
+  int64_t tick_ns = 1000 * 1000 * 1000 / TIMER_FREQ;
+  size_t i;
+
+  for (i = 0; i < sizeof sleep_us / sizeof *sleep_us; i++)
+    {
+      int64_t start, elapsed, want = sleep_us[i] * 1000;
+
+      start = timer_ns ();
+      timer_usleep (sleep_us[i]);
+      elapsed = timer_ns () - start;
+
+      if (elapsed < want)
+        fail ("timer_usleep (%lld) returned after only %lld ns",
+              sleep_us[i], elapsed);
+      if (elapsed >= want + tick_ns)
+        fail ("timer_usleep (%lld) took %lld ns, over a tick too long",
+              sleep_us[i], elapsed);
+      msg ("Slept %lld us.", sleep_us[i]);
+    }
+}
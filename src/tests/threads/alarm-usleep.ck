@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) Slept 10 us.
+(alarm-usleep) Slept 100 us.
+(alarm-usleep) Slept 1000 us.
+(alarm-usleep) Slept 5000 us.
+(alarm-usleep) end
+EOF
+pass;
@@ -0,0 +1,125 @@
+/* Measures the fairness of the completely fair scheduler.
+
+   The cfs-fair-20 test runs 20 CPU-bound threads, all at nice
+   0, which should each receive the same number of ticks, about
+   3000 / 20 == 150 over 30 seconds.  The cfs-nice-10 test runs
+   10 threads with nice 0 through 9, which should receive ticks
+   in proportion to their CFS weights: 671, 537, 429, 345, 277,
+   219, 178, 141, 113, and 90 ticks, respectively.
+
+   The cfs-fair-20 test also reports the spread between the
+   largest and smallest number of ticks received, as a
+   percentage of the mean. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_cfs_fair (int thread_cnt, int nice_min, int nice_step);
+
+void
+test_cfs_fair_20 (void) 
+{
+  test_cfs_fair (20, 0, 0);
+}
+
+void
+test_cfs_nice_10 (void) 
+{
+  test_cfs_fair (10, 0, 1);
+}
+
+#define MAX_THREAD_CNT 20
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int tick_count;
+    int nice;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_cfs_fair (int thread_cnt, int nice_min, int nice_step)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int min, max, total;
+  int nice;
+  int i;
+
+  ASSERT (thread_cfs);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+  ASSERT (nice_min >= NICE_MIN);
+  ASSERT (nice_step >= 0);
+  ASSERT (nice_min + nice_step * (thread_cnt - 1) <= NICE_MAX);
+
+  thread_set_nice (NICE_MIN);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  nice = nice_min;
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->nice = nice;
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+
+      nice += nice_step;
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 40 seconds to let threads run, please wait...");
+  timer_sleep (40 * TIMER_FREQ);
+
+  min = max = total = info[0].tick_count;
+  for (i = 0; i < thread_cnt; i++)
+    {
+      int count = info[i].tick_count;
+
+      msg ("Thread %d received %d ticks.", i, count);
+      if (i > 0)
+        {
+          total += count;
+          if (count < min)
+            min = count;
+          if (count > max)
+            max = count;
+        }
+    }
+  if (nice_step == 0 && total / thread_cnt > 0)
+    {
+      int spread = (max - min) * 10000 / (total / thread_cnt);
+      msg ("CPU share: min %d, max %d ticks, spread %d.%02d%% of mean.",
+           min, max, spread / 100, spread % 100);
+    }
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_nice (ti->nice);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,136 @@
+/* Runs three periodic threads in the EDF scheduling class,
+   alongside two CPU-bound threads at the highest priority, and
+   reports how many of each EDF thread's deadlines were missed.
+
+   The EDF threads have a total density of about 0.77, so EDF
+   should meet every deadline even though the CPU-bound threads
+   would starve any thread scheduled by priority.  Admission
+   control must then reject a fourth EDF thread that would push
+   the total density past 1. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define RUN_TICKS 400           /* Ticks each EDF thread runs for. */
+#define HOG_CNT 2               /* Number of CPU-bound threads. */
+
+/* A periodic EDF thread. */
+struct edf_task
+  {
+    const char *name;           /* Thread name. */
+    int period;                 /* Period, in ticks. */
+    int runtime;                /* Run time per period, in ticks. */
+    int deadline;               /* Deadline relative to period start. */
+    bool admitted;              /* Accepted by thread_set_edf()? */
+    uint32_t jobs;              /* Jobs completed. */
+    uint32_t misses;            /* Jobs completed past deadline. */
+  };
+
+static struct edf_task tasks[] =
+  {
+    {"edf 10/3/10", 10, 3, 10, false, 0, 0},
+    {"edf 20/4/15", 20, 4, 15, false, 0, 0},
+    {"edf 40/8/40", 40, 8, 40, false, 0, 0},
+  };
+#define TASK_CNT ((int) (sizeof tasks / sizeof *tasks))
+
+static struct semaphore done;   /* Upped by each thread as it exits. */
+static int running_cnt;         /* EDF threads still running. */
+static volatile bool stop;      /* Tells the CPU-bound threads to exit. */
+
+static thread_func edf_thread;
+static thread_func hog_thread;
+
+void
+test_edf_periodic (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  running_cnt = TASK_CNT;
+  stop = false;
+
+  /* The EDF threads start above our priority, so each one has
+     registered by the time thread_create() returns. */
+  for (i = 0; i < TASK_CNT; i++)
+    thread_create (tasks[i].name, PRI_DEFAULT + 1, edf_thread, &tasks[i]);
+  for (i = 0; i < TASK_CNT; i++)
+    if (!tasks[i].admitted)
+      fail ("%s was not admitted", tasks[i].name);
+
+  if (thread_set_edf (10, 3, 10))
+    fail ("admitted EDF thread beyond total density 1");
+  msg ("Admission control rejected period 10, run time 3, deadline 10.");
+
+  /* The CPU-bound threads keep us from running again until the
+     last EDF thread tells them to stop. */
+  for (i = 0; i < HOG_CNT; i++)
+    thread_create ("hog", PRI_MAX, hog_thread, NULL);
+
+  for (i = 0; i < TASK_CNT + HOG_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < TASK_CNT; i++)
+    msg ("%s: %"PRIu32" jobs, %"PRIu32" missed deadlines.",
+         tasks[i].name, tasks[i].jobs, tasks[i].misses);
+}
+
+/* Periodic EDF thread.  Each job spins for one tick less than
+   its run time, measured in ticks charged to this thread, then
+   waits for the next period. */
+static void
+edf_thread (void *task_) 
+{
+  struct edf_task *task = task_;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int job_cnt = RUN_TICKS / task->period;
+  int job;
+
+  task->admitted = thread_set_edf (task->period, task->runtime,
+                                   task->deadline);
+  if (!task->admitted)
+    {
+      sema_up (&done);
+      return;
+    }
+
+  for (job = 0; job < job_cnt; job++)
+    {
+      int64_t start = cur->stats.run_ticks;
+      while (cur->stats.run_ticks - start < task->runtime - 1)
+        barrier ();
+      thread_edf_yield ();
+    }
+
+  task->jobs = cur->stats.edf_jobs;
+  task->misses = cur->stats.edf_misses;
+
+  /* Stop the CPU-bound threads before leaving the EDF class,
+     since they would never let us run again afterward. */
+  old_level = intr_disable ();
+  if (--running_cnt == 0)
+    stop = true;
+  intr_set_level (old_level);
+
+  thread_clear_edf ();
+  sema_up (&done);
+}
+
+/* CPU-bound thread that spins until told to stop. */
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  sema_up (&done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-periodic) begin
+(edf-periodic) Admission control rejected period 10, run time 3, deadline 10.
+(edf-periodic) edf 10/3/10: 40 jobs, 0 missed deadlines.
+(edf-periodic) edf 20/4/15: 20 jobs, 0 missed deadlines.
+(edf-periodic) edf 40/8/40: 10 jobs, 0 missed deadlines.
+(edf-periodic) end
+EOF
+pass;
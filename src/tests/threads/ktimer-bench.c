@@ -0,0 +1,127 @@
+/* Measures the cost of adding, modifying, canceling, and
+   expiring a kernel timer as a function of the number of timers
+   already pending.
+
+   For each run, the main thread adds a number of background
+   timers that expire at scattered ticks up to several days
+   away, so that they land at every level of the timing wheel,
+   and then times OP_CNT more timers through each operation.
+   To time expiry, it adds OP_CNT timers for the same tick and
+   measures from the first of their functions to the last.  With
+   a timing wheel the cost per operation should not depend on the
+   number of pending timers. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "devices/ktimer.h"
+#include "devices/timer.h"
+
+#define OP_CNT 1000             /* Timers timed per operation. */
+#define SPREAD (1 << 24)        /* Background timers expire this far out. */
+
+static const int pending_cnts[] = {10, 1000, 100000};
+
+static ktimer_func null_expire, timed_expire;
+
+/* Timer functions run by timed_expire() so far, and the cycle
+   counter when the first and the latest of them ran. */
+static int expired_cnt;
+static uint64_t first_expire, last_expire;
+
+void
+test_ktimer_bench (void)
+{
+  struct ktimer *timers, *ops;
+  size_t i;
+
+  timers = malloc (sizeof *timers * pending_cnts[2]);
+  ops = malloc (sizeof *ops * OP_CNT);
+  if (timers == NULL || ops == NULL)
+    PANIC ("couldn't allocate memory for test");
+  random_init (0);
+
+  for (i = 0; i < sizeof pending_cnts / sizeof *pending_cnts; i++)
+    {
+      int cnt = pending_cnts[i];
+      uint64_t start, add, modify, cancel, expire;
+      enum intr_level old_level;
+      int64_t now;
+      int j;
+
+      now = timer_ticks ();
+      for (j = 0; j < cnt; j++)
+        {
+          ktimer_init (&timers[j], null_expire, NULL);
+          ktimer_add (&timers[j], now + 1000 + random_ulong () % SPREAD);
+        }
+      for (j = 0; j < OP_CNT; j++)
+        ktimer_init (&ops[j], null_expire, NULL);
+
+      /* Keep the timer interrupt out of the measurements. */
+      old_level = intr_disable ();
+      start = timer_cycles ();
+      for (j = 0; j < OP_CNT; j++)
+        ktimer_add (&ops[j], now + 1000 + random_ulong () % SPREAD);
+      add = timer_cycles () - start;
+
+      start = timer_cycles ();
+      for (j = 0; j < OP_CNT; j++)
+        ktimer_modify (&ops[j], now + 1000 + random_ulong () % SPREAD);
+      modify = timer_cycles () - start;
+
+      start = timer_cycles ();
+      for (j = 0; j < OP_CNT; j++)
+        ktimer_cancel (&ops[j]);
+      cancel = timer_cycles () - start;
+
+      /* Let OP_CNT timers expire together at the next tick but
+         one. */
+      expired_cnt = 0;
+      now = timer_ticks ();
+      for (j = 0; j < OP_CNT; j++)
+        {
+          ktimer_init (&ops[j], timed_expire, NULL);
+          ktimer_add (&ops[j], now + 2);
+        }
+      intr_set_level (old_level);
+      timer_sleep_until (now + 3);
+      if (expired_cnt != OP_CNT)
+        fail ("%d of %d timers expired", expired_cnt, OP_CNT);
+      expire = last_expire - first_expire;
+
+      msg ("%d pending timers: %llu cycles per add, %llu per modify, "
+           "%llu per cancel, %llu per expire.", cnt, add / OP_CNT,
+           modify / OP_CNT, cancel / OP_CNT, expire / (OP_CNT - 1));
+
+      for (j = 0; j < cnt; j++)
+        if (!ktimer_cancel (&timers[j]))
+          fail ("background timer %d expired early", j);
+    }
+
+  free (ops);
+  free (timers);
+}
+
+/* Timer function for the timers whose expiry is timed.  Records
+   when the first and the latest of them ran. */
+static void
+timed_expire (void *aux UNUSED)
+{
+  uint64_t now = timer_cycles ();
+
+  if (expired_cnt++ == 0)
+    first_expire = now;
+  last_expire = now;
+}
+
+/* Timer function for the benchmark's timers, none of which
+   should expire. */
+static void
+null_expire (void *aux UNUSED)
+{
+  fail ("benchmark timer expired");
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%cycles);
+foreach (@output) {
+    my ($cnt, $add, $modify, $cancel, $expire)
+      = /(\d+) pending timers: (\d+) cycles per add, (\d+) per modify, (\d+) per cancel, (\d+) per expire/
+      or next;
+    $cycles{$cnt} = $add + $modify + $cancel + $expire;
+}
+fail "missing timer costs with 10 pending timers\n" if !defined $cycles{10};
+fail "missing timer costs with 100000 pending timers\n"
+  if !defined $cycles{100000};
+
+# Timer operations with 100000 timers pending must not cost much
+# more than with 10.
+my ($base) = $cycles{10} > 0 ? $cycles{10} : 1;
+fail "timer operations with 100000 pending timers took $cycles{100000} "
+  . "cycles, vs. $base with 10\n"
+  if $cycles{100000} > 4 * $base;
+pass;
@@ -0,0 +1,108 @@
+/* Checks kernel timers that start out in the outer levels of the
+   timing wheel.  Timers 256 or more ticks away wait in level 1
+   until level 0 wraps around and they cascade into it; those
+   checked here expire just after a cascade, exactly at one, and
+   after being modified or canceled once they have cascaded.  A
+   timer far enough out for level 2 must still be pending after
+   all of that. */
+
+#include <round.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "devices/ktimer.h"
+#include "devices/timer.h"
+
+/* Ticks covered by level 0 of the wheel, which cascades level 1
+   into itself each time its index wraps around. */
+#define ROOT_SLOTS 256
+
+/* A test timer. */
+struct test_timer
+  {
+    struct ktimer timer;        /* Kernel timer. */
+    char name;                  /* Name for output. */
+    int runs;                   /* Number of times expired. */
+  };
+
+/* Timer expirations, in order. */
+static struct
+  {
+    char name;                  /* Timer that expired. */
+    int64_t tick;               /* Tick it expired at. */
+  }
+events[16];
+static int event_cnt;
+
+static ktimer_func record_expire;
+
+/* Initializes test timer T with the given NAME. */
+static void
+init_test_timer (struct test_timer *t, char name)
+{
+  ktimer_init (&t->timer, record_expire, t);
+  t->name = name;
+  t->runs = 0;
+}
+
+void
+test_ktimer_cascade (void) 
+{
+  struct test_timer h, i, j, k, l, m;
+  int64_t base, boundary;
+  int e;
+
+  /* Start just after a tick, and find the first tick after it at
+     which level 1 cascades. */
+  timer_sleep (1);
+  base = timer_ticks ();
+  boundary = ROUND_UP (base + 1, ROOT_SLOTS);
+
+  init_test_timer (&h, 'H');
+  init_test_timer (&i, 'I');
+  init_test_timer (&j, 'J');
+  init_test_timer (&k, 'K');
+  init_test_timer (&l, 'L');
+  init_test_timer (&m, 'M');
+
+  ktimer_add (&k.timer, boundary + 5);
+  ktimer_add (&m.timer, boundary + ROOT_SLOTS);
+  ktimer_add (&h.timer, boundary + ROOT_SLOTS + 10);
+  ktimer_add (&i.timer, boundary + ROOT_SLOTS + 44);
+  ktimer_add (&j.timer, boundary + ROOT_SLOTS + 144);
+  ktimer_add (&l.timer, base + 64 * ROOT_SLOTS + 100);
+
+  /* Wait for the cascade at BOUNDARY + ROOT_SLOTS, which moves H,
+     I, and J into level 0, then move I earlier and cancel J. */
+  timer_sleep_until (boundary + ROOT_SLOTS + 1);
+  if (!ktimer_modify (&i.timer, boundary + ROOT_SLOTS + 20))
+    fail ("timer I was not pending when modified after cascading");
+  if (!ktimer_cancel (&j.timer))
+    fail ("timer J was not pending when canceled after cascading");
+
+  timer_sleep_until (boundary + ROOT_SLOTS + 50);
+
+  for (e = 0; e < event_cnt; e++)
+    msg ("Tick %lld: timer %c.", events[e].tick - boundary, events[e].name);
+
+  if (j.runs != 0)
+    fail ("canceled timer J expired");
+  if (l.runs != 0 || !ktimer_cancel (&l.timer))
+    fail ("level 2 timer L was not pending");
+  msg ("Canceled timer did not expire.");
+  msg ("Level 2 timer still pending.");
+}
+
+/* Records that a test timer expired. */
+static void
+record_expire (void *t_) 
+{
+  struct test_timer *t = t_;
+
+  ASSERT (intr_context ());
+  t->runs++;
+  events[event_cnt].name = t->name;
+  events[event_cnt].tick = timer_ticks ();
+  event_cnt++;
+}
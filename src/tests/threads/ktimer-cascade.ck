@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ktimer-cascade) begin
+(ktimer-cascade) Tick 5: timer K.
+(ktimer-cascade) Tick 256: timer M.
+(ktimer-cascade) Tick 266: timer H.
+(ktimer-cascade) Tick 276: timer I.
+(ktimer-cascade) Canceled timer did not expire.
+(ktimer-cascade) Level 2 timer still pending.
+(ktimer-cascade) end
+EOF
+pass;
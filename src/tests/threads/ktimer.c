@@ -0,0 +1,107 @@
+/* Checks that kernel timers expire at the right ticks, in the
+   order they were added when they expire together, and that
+   modified and canceled timers behave accordingly.  One timer
+   re-adds itself from its own function to run periodically. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "devices/ktimer.h"
+#include "devices/timer.h"
+
+#define PERIODIC_CNT 3          /* Times the periodic timer runs. */
+
+/* A test timer. */
+struct test_timer
+  {
+    struct ktimer timer;        /* Kernel timer. */
+    char name;                  /* Name for output. */
+    int runs;                   /* Number of times expired. */
+  };
+
+/* Timer expirations, in order. */
+static struct
+  {
+    char name;                  /* Timer that expired. */
+    int64_t tick;               /* Tick it expired at. */
+  }
+events[16];
+static int event_cnt;
+
+static int64_t base;
+
+static ktimer_func record_expire, periodic_expire;
+
+void
+test_ktimer (void) 
+{
+  struct test_timer a, b, c, d, e, f;
+  int i;
+
+  /* Start just after a tick, so that all of the timers are added
+     well before the next one. */
+  timer_sleep (1);
+  base = timer_ticks ();
+
+  ktimer_init (&a.timer, record_expire, &a);
+  ktimer_init (&b.timer, record_expire, &b);
+  ktimer_init (&c.timer, record_expire, &c);
+  ktimer_init (&d.timer, record_expire, &d);
+  ktimer_init (&e.timer, record_expire, &e);
+  ktimer_init (&f.timer, periodic_expire, &f);
+  a.name = 'A';
+  b.name = 'B';
+  c.name = 'C';
+  d.name = 'D';
+  e.name = 'E';
+  f.name = 'F';
+  a.runs = b.runs = c.runs = d.runs = e.runs = f.runs = 0;
+
+  ktimer_add (&a.timer, base + 3);
+  ktimer_add (&b.timer, base + 1);
+  ktimer_add (&c.timer, base + 2);
+  ktimer_add (&d.timer, base + 2);
+  ktimer_add (&e.timer, base + 5);
+  ktimer_add (&f.timer, base + 1);
+  if (!ktimer_cancel (&e.timer))
+    fail ("timer E was not pending when canceled");
+  if (!ktimer_modify (&b.timer, base + 4))
+    fail ("timer B was not pending when modified");
+
+  timer_sleep_until (base + 10);
+
+  for (i = 0; i < event_cnt; i++)
+    msg ("Tick %lld: timer %c.", events[i].tick - base, events[i].name);
+
+  if (ktimer_pending (&a.timer) || ktimer_cancel (&a.timer))
+    fail ("timer A still pending after it expired");
+  if (ktimer_pending (&e.timer) || e.runs != 0)
+    fail ("canceled timer E expired");
+  msg ("Canceled timer did not expire.");
+}
+
+/* Records that a test timer expired. */
+static void
+record_expire (void *t_) 
+{
+  struct test_timer *t = t_;
+
+  ASSERT (intr_context ());
+  t->runs++;
+  events[event_cnt].name = t->name;
+  events[event_cnt].tick = timer_ticks ();
+  event_cnt++;
+}
+
+/* Records that a test timer expired, and re-adds it for the next
+   tick until it has run PERIODIC_CNT times. */
+static void
+periodic_expire (void *t_) 
+{
+  struct test_timer *t = t_;
+
+  record_expire (t);
+  if (t->runs < PERIODIC_CNT)
+    ktimer_add (&t->timer, timer_ticks () + 1);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ktimer) begin
+(ktimer) Tick 1: timer F.
+(ktimer) Tick 2: timer C.
+(ktimer) Tick 2: timer D.
+(ktimer) Tick 2: timer F.
+(ktimer) Tick 3: timer A.
+(ktimer) Tick 3: timer F.
+(ktimer) Tick 4: timer B.
+(ktimer) Canceled timer did not expire.
+(ktimer) end
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* Measures the cost of schedule() as a function of the number of
+   ready threads.
+
+   For each run, the main thread creates a number of threads at a
+   lower priority, so that they sit in the run queue without
+   running, and then yields repeatedly.  Each yield goes through
+   schedule(), which must pick the main thread again as the
+   highest-priority ready thread.  With per-priority run queues
+   the cost per yield should not depend on the number of ready
+   threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define YIELD_CNT 1000          /* Yields timed per run. */
+
+static const int ready_cnts[] = {1, 10, 100, 1000, 4000};
+
+static void ready_thread (void *);
+
+void
+test_priority_bench (void)
+{
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < sizeof ready_cnts / sizeof *ready_cnts; i++)
+    {
+      uint64_t start, cycles;
+      int created, j;
+
+      for (created = 0; created < ready_cnts[i]; created++)
+        {
+          /* Spread the waiting threads over all of the lower
+             priority levels. */
+          int priority = PRI_MIN + 1 + created % (PRI_DEFAULT - PRI_MIN - 1);
+          if (thread_create ("ready", priority, ready_thread, NULL)
+              == TID_ERROR)
+            break;
+        }
+      if (thread_ready_count () < created)
+        fail ("only %d of %d threads are ready",
+              thread_ready_count (), created);
+
+      start = timer_cycles ();
+      for (j = 0; j < YIELD_CNT; j++)
+        thread_yield ();
+      cycles = timer_cycles () - start;
+
+      msg ("%d ready threads: %llu cycles per schedule.",
+           created, cycles / YIELD_CNT);
+
+      /* Let the waiting threads run and exit. */
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_DEFAULT);
+    }
+}
+
+/* Thread function for the threads that wait in the run queue.
+   They have nothing to do once they finally get to run. */
+static void
+ready_thread (void *aux UNUSED)
+{
+}
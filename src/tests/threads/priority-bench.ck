@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%cycles);
+foreach (@output) {
+    my ($cnt, $cost) = /(\d+) ready threads: (\d+) cycles per schedule/
+      or next;
+    $cycles{$cnt} = $cost;
+}
+fail "missing schedule() cost with 1 ready thread\n" if !defined $cycles{1};
+fail "missing schedule() cost with 100 ready threads\n"
+  if !defined $cycles{100};
+
+# schedule() must not get much slower as the run queue grows.
+my ($base) = $cycles{1} > 0 ? $cycles{1} : 1;
+foreach my $cnt (sort { $a <=> $b } keys %cycles) {
+    fail "schedule() with $cnt ready threads took $cycles{$cnt} cycles, "
+      . "vs. $base with 1\n"
+      if $cycles{$cnt} > 3 * $base;
+}
+pass;
@@ -0,0 +1,96 @@
+/* Measures how long a high-priority thread waits for a lock held
+   by a low-priority thread while medium-priority threads keep the
+   CPU busy, the classic priority inversion scenario.
+
+   Without priority donation, the low-priority holder cannot run
+   until every medium-priority thread has finished spinning, so
+   the high-priority thread waits for all of them.  With
+   donation, the holder runs at the waiter's priority, releases
+   the lock, and the wait is a small fraction of a tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 5             /* Number of inversion scenarios. */
+#define SPINNER_CNT 3           /* Medium-priority threads per round. */
+#define SPIN_TICKS 20           /* Ticks each medium thread spins. */
+
+#define PRI_LOW (PRI_DEFAULT - 10)
+#define PRI_MEDIUM (PRI_DEFAULT - 5)
+
+static thread_func low_thread_func;
+static thread_func medium_thread_func;
+
+void
+test_priority_donate_bench (void)
+{
+  struct lock lock;
+  struct semaphore done;
+  int64_t total_wait = 0, max_wait = 0;
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  sema_init (&done, 0);
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      int64_t start, wait;
+
+      /* The low thread starts out above us so that it grabs the
+         lock right away, then drops to its low priority. */
+      thread_create ("low", PRI_DEFAULT + 1, low_thread_func, &lock);
+      for (i = 0; i < SPINNER_CNT; i++)
+        thread_create ("medium", PRI_MEDIUM, medium_thread_func, &done);
+
+      start = timer_ticks ();
+      lock_acquire (&lock);
+      wait = timer_elapsed (start);
+      lock_release (&lock);
+
+      total_wait += wait;
+      if (wait > max_wait)
+        max_wait = wait;
+
+      /* Let this round's medium threads finish. */
+      for (i = 0; i < SPINNER_CNT; i++)
+        sema_down (&done);
+    }
+
+  msg ("High-priority lock wait: max %lld, average %lld.%02lld ticks.",
+       max_wait, total_wait / ROUND_CNT, total_wait * 100 / ROUND_CNT % 100);
+  msg ("Medium-priority threads spun %d ticks each.", SPIN_TICKS);
+}
+
+/* Acquires the lock, then lowers its priority and holds the lock
+   until it gets to run again. */
+static void
+low_thread_func (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  thread_set_priority (PRI_LOW);
+  lock_release (lock);
+}
+
+/* Keeps the CPU busy for SPIN_TICKS ticks. */
+static void
+medium_thread_func (void *done_)
+{
+  struct semaphore *done = done_;
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+  sema_up (done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($max_wait, $spin);
+foreach (@output) {
+    ($max_wait) = /lock wait: max (\d+)/ if !defined $max_wait;
+    ($spin) = /spun (\d+) ticks each/ if !defined $spin;
+}
+fail "missing lock wait statistics\n" if !defined $max_wait || !defined $spin;
+
+# Waiting as long as one medium-priority thread's spin means the
+# lock holder was starved, i.e. priority was not donated.
+fail "high-priority thread waited $max_wait ticks for the lock\n"
+  if $max_wait >= $spin;
+pass;
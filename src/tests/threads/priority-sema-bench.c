@@ -0,0 +1,129 @@
+/* Measures the cost of sema_up() as a function of the number of
+   threads waiting on the semaphore, and checks the order in
+   which the waiters are woken.
+
+   For each run, the main thread creates waiters at a range of
+   priorities above its own, each of which blocks on the
+   semaphore as soon as it runs.  The main thread then raises its
+   priority above all of them, so that the woken waiters do not
+   preempt it, and times one sema_up() per waiter.  With a
+   priority queue of waiters the cost per wakeup should grow no
+   faster than the logarithm of the number of waiters.
+
+   Once the main thread lowers its priority again, the waiters
+   run in the order they were woken within each priority, so
+   recording the order in which they run shows whether waiters
+   of equal priority were woken first come, first served. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define PRI_SPREAD 16           /* Number of distinct waiter priorities. */
+
+static const int waiter_cnts[] = {1, 10, 100, 1000};
+
+/* Information about the test. */
+struct bench_test
+  {
+    struct semaphore sema;      /* Semaphore waited on. */
+    int *order;                 /* Waiter numbers, in order run. */
+    int run_cnt;                /* Number of waiters that have run. */
+  };
+
+/* Information about an individual waiter. */
+struct bench_waiter
+  {
+    struct bench_test *test;    /* Info shared between all threads. */
+    int id;                     /* Waiter number. */
+  };
+
+static thread_func waiter_thread;
+static int waiter_priority (int id);
+
+void
+test_priority_sema_bench (void)
+{
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < sizeof waiter_cnts / sizeof *waiter_cnts; i++)
+    {
+      int cnt = waiter_cnts[i];
+      struct bench_test test;
+      struct bench_waiter *waiters;
+      uint64_t start, cycles;
+      int j;
+
+      waiters = malloc (sizeof *waiters * cnt);
+      test.order = malloc (sizeof *test.order * cnt);
+      if (waiters == NULL || test.order == NULL)
+        PANIC ("couldn't allocate memory for test");
+      sema_init (&test.sema, 0);
+      test.run_cnt = 0;
+
+      for (j = 0; j < cnt; j++)
+        {
+          waiters[j].test = &test;
+          waiters[j].id = j;
+          if (thread_create ("waiter", waiter_priority (j), waiter_thread,
+                             &waiters[j]) == TID_ERROR)
+            fail ("couldn't create waiter %d", j);
+        }
+
+      thread_set_priority (PRI_MAX);
+      start = timer_cycles ();
+      for (j = 0; j < cnt; j++)
+        sema_up (&test.sema);
+      cycles = timer_cycles () - start;
+      thread_set_priority (PRI_DEFAULT);
+
+      if (test.run_cnt != cnt)
+        fail ("only %d of %d waiters ran", test.run_cnt, cnt);
+      for (j = 1; j < cnt; j++)
+        {
+          int a = test.order[j - 1], b = test.order[j];
+          int pa = waiter_priority (a), pb = waiter_priority (b);
+          if (pa < pb || (pa == pb && a > b))
+            fail ("waiter %d (priority %d) ran before waiter %d "
+                  "(priority %d)", a, pa, b, pb);
+        }
+
+      msg ("%d waiters: %llu cycles per sema_up.", cnt, cycles / cnt);
+
+      free (test.order);
+      free (waiters);
+    }
+  msg ("Waiters woken by priority, equal priorities in FIFO order.");
+}
+
+/* Returns the priority of waiter ID. */
+static int
+waiter_priority (int id)
+{
+  return PRI_DEFAULT + 1 + id % PRI_SPREAD;
+}
+
+/* Waiter thread.  Blocks on the semaphore, then records that it
+   ran. */
+static void
+waiter_thread (void *w_)
+{
+  struct bench_waiter *w = w_;
+  struct bench_test *test = w->test;
+  enum intr_level old_level;
+
+  sema_down (&test->sema);
+
+  old_level = intr_disable ();
+  test->order[test->run_cnt++] = w->id;
+  intr_set_level (old_level);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%cycles, $ordered);
+foreach (@output) {
+    $ordered = 1 if /Waiters woken by priority/;
+    my ($cnt, $cost) = /(\d+) waiters: (\d+) cycles per sema_up/
+      or next;
+    $cycles{$cnt} = $cost;
+}
+fail "missing wakeup order check\n" if !$ordered;
+fail "missing sema_up() cost with 10 waiters\n" if !defined $cycles{10};
+fail "missing sema_up() cost with 1000 waiters\n" if !defined $cycles{1000};
+
+# Waking one of 1000 waiters must not cost much more than waking
+# one of 10.
+my ($base) = $cycles{10} > 0 ? $cycles{10} : 1;
+fail "sema_up() with 1000 waiters took $cycles{1000} cycles, "
+  . "vs. $base with 10\n"
+  if $cycles{1000} > 4 * $base;
+pass;
@@ -0,0 +1,144 @@
+/* Compares a readers-writer lock against an exclusive lock for a
+   read-mostly workload like file name lookup.
+
+   Several threads each perform a number of "lookups" that hold
+   the lock across a one-tick sleep, standing in for a directory
+   read that waits on the disk.  Under an exclusive lock the
+   lookups run one at a time, so the total time grows with the
+   number of threads; under the readers-writer lock they overlap.
+   Every tenth lookup by the first thread is a write, which must
+   still get in between the readers.  The cost of an uncontended
+   acquire and release is reported as well. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8            /* Number of looking-up threads. */
+#define LOOKUP_CNT 10           /* Lookups per thread. */
+#define WRITE_EVERY 10          /* First thread writes this often. */
+#define ACQUIRE_CNT 10000       /* Uncontended acquires timed. */
+
+/* Information shared by the lookup threads. */
+struct bench_test
+  {
+    bool exclusive;             /* Use LOCK instead of RW? */
+    struct lock lock;           /* Exclusive lock. */
+    struct rwlock rw;           /* Readers-writer lock. */
+    int writes;                 /* Writes completed. */
+    struct semaphore done;      /* Upped by each thread when done. */
+  };
+
+/* Information about an individual lookup thread. */
+struct bench_thread
+  {
+    struct bench_test *test;    /* Info shared between all threads. */
+    int id;                     /* Thread number. */
+  };
+
+static thread_func lookup_thread;
+static int64_t run_lookups (struct bench_test *, bool exclusive);
+
+void
+test_rwlock_bench (void)
+{
+  struct bench_test test;
+  int64_t exclusive_ticks, shared_ticks;
+  uint64_t start, lock_cycles, read_cycles;
+  int i;
+
+  lock_init (&test.lock);
+  rwlock_init (&test.rw);
+  sema_init (&test.done, 0);
+
+  start = timer_cycles ();
+  for (i = 0; i < ACQUIRE_CNT; i++)
+    {
+      lock_acquire (&test.lock);
+      lock_release (&test.lock);
+    }
+  lock_cycles = (timer_cycles () - start) / ACQUIRE_CNT;
+
+  start = timer_cycles ();
+  for (i = 0; i < ACQUIRE_CNT; i++)
+    {
+      rwlock_acquire_read (&test.rw);
+      rwlock_release_read (&test.rw);
+    }
+  read_cycles = (timer_cycles () - start) / ACQUIRE_CNT;
+
+  exclusive_ticks = run_lookups (&test, true);
+  shared_ticks = run_lookups (&test, false);
+
+  msg ("%d threads, %d lookups each, %d writes.",
+       THREAD_CNT, LOOKUP_CNT, test.writes);
+  msg ("Exclusive lock: %lld ticks.", exclusive_ticks);
+  msg ("Readers-writer lock: %lld ticks.", shared_ticks);
+  msg ("Uncontended acquire and release: lock %llu, read %llu cycles.",
+       lock_cycles, read_cycles);
+}
+
+/* Runs THREAD_CNT lookup threads to completion, using an
+   exclusive lock if EXCLUSIVE is true or the readers-writer lock
+   otherwise, and returns the number of ticks they took. */
+static int64_t
+run_lookups (struct bench_test *test, bool exclusive)
+{
+  struct bench_thread threads[THREAD_CNT];
+  int64_t start;
+  int i;
+
+  test->exclusive = exclusive;
+  test->writes = 0;
+
+  /* Start out on a tick boundary. */
+  timer_sleep (1);
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      threads[i].test = test;
+      threads[i].id = i;
+      if (thread_create ("lookup", PRI_DEFAULT, lookup_thread, &threads[i])
+          == TID_ERROR)
+        fail ("couldn't create lookup thread %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test->done);
+  return timer_elapsed (start);
+}
+
+/* Lookup thread. */
+static void
+lookup_thread (void *t_)
+{
+  struct bench_thread *t = t_;
+  struct bench_test *test = t->test;
+  int i;
+
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      bool write = t->id == 0 && i % WRITE_EVERY == WRITE_EVERY - 1;
+
+      if (test->exclusive)
+        lock_acquire (&test->lock);
+      else if (write)
+        rwlock_acquire_write (&test->rw);
+      else
+        rwlock_acquire_read (&test->rw);
+
+      timer_sleep (1);
+      if (write)
+        test->writes++;
+
+      if (test->exclusive)
+        lock_release (&test->lock);
+      else if (write)
+        rwlock_release_write (&test->rw);
+      else
+        rwlock_release_read (&test->rw);
+    }
+  sema_up (&test->done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($writes, $exclusive, $shared);
+foreach (@output) {
+    ($writes) = /(\d+) writes\./ if !defined $writes;
+    ($exclusive) = /Exclusive lock: (\d+) ticks/ if !defined $exclusive;
+    ($shared) = /Readers-writer lock: (\d+) ticks/ if !defined $shared;
+}
+fail "missing lookup statistics\n"
+  if !defined $writes || !defined $exclusive || !defined $shared;
+fail "writer made $writes writes, expected 1\n" if $writes != 1;
+fail "readers did not overlap: $shared ticks with readers-writer lock, "
+  . "$exclusive with exclusive lock\n" if $shared * 2 > $exclusive;
+pass;
@@ -0,0 +1,77 @@
+/* Checks the readers-writer lock: readers share it, a waiting
+   writer holds off new readers, upgrade and downgrade work and
+   refuse to deadlock, and waiters are let in by priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_func;
+static thread_func writer_func;
+
+static struct rwlock rw;
+
+void
+test_rwlock (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+
+  /* Readers share the lock, but not with a waiting writer. */
+  rwlock_acquire_read (&rw);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_func, NULL);
+  thread_create ("writer 1", PRI_DEFAULT + 2, writer_func, NULL);
+  thread_create ("reader 2", PRI_DEFAULT + 1, reader_func, NULL);
+  msg ("main releasing read lock.");
+  rwlock_release_read (&rw);
+
+  /* Upgrade and downgrade. */
+  rwlock_acquire_read (&rw);
+  if (!rwlock_try_upgrade (&rw))
+    fail ("upgrade with no other readers failed");
+  msg ("main upgraded to write lock.");
+  thread_create ("reader 3", PRI_DEFAULT + 1, reader_func, NULL);
+  msg ("main downgrading to read lock.");
+  rwlock_downgrade (&rw);
+  rwlock_release_read (&rw);
+
+  /* An upgrade must not wait for a writer that waits for us. */
+  rwlock_acquire_read (&rw);
+  thread_create ("writer 2", PRI_DEFAULT + 1, writer_func, NULL);
+  if (rwlock_try_upgrade (&rw))
+    fail ("upgrade succeeded while a writer was waiting");
+  msg ("main's upgrade refused while writer 2 waits.");
+  rwlock_release_read (&rw);
+
+  /* Waiters get in by priority. */
+  rwlock_acquire_write (&rw);
+  thread_create ("writer 3", PRI_DEFAULT + 1, writer_func, NULL);
+  thread_create ("reader 4", PRI_DEFAULT + 3, reader_func, NULL);
+  thread_create ("writer 4", PRI_DEFAULT + 2, writer_func, NULL);
+  msg ("main releasing write lock.");
+  rwlock_release_write (&rw);
+  msg ("main done.");
+}
+
+static void
+reader_func (void *aux UNUSED)
+{
+  rwlock_acquire_read (&rw);
+  msg ("%s acquired read lock.", thread_name ());
+  rwlock_release_read (&rw);
+}
+
+static void
+writer_func (void *aux UNUSED)
+{
+  rwlock_acquire_write (&rw);
+  msg ("%s acquired write lock.", thread_name ());
+  rwlock_release_write (&rw);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock) begin
+(rwlock) reader 1 acquired read lock.
+(rwlock) main releasing read lock.
+(rwlock) writer 1 acquired write lock.
+(rwlock) reader 2 acquired read lock.
+(rwlock) main upgraded to write lock.
+(rwlock) main downgrading to read lock.
+(rwlock) reader 3 acquired read lock.
+(rwlock) main's upgrade refused while writer 2 waits.
+(rwlock) writer 2 acquired write lock.
+(rwlock) main releasing write lock.
+(rwlock) reader 4 acquired read lock.
+(rwlock) writer 4 acquired write lock.
+(rwlock) writer 3 acquired write lock.
+(rwlock) main done.
+(rwlock) end
+EOF
+pass;
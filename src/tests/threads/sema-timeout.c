@@ -0,0 +1,102 @@
+/* Checks sema_down_timeout() and lock_acquire_timeout(): a wait
+   that times out returns false no sooner than its timeout, a
+   wait that is satisfied in time returns true as soon as it is,
+   and a lock wait that times out withdraws the priority it
+   donated to the lock's holder. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMEOUT 5               /* Ticks to wait before giving up. */
+
+/* Shared with the helper threads. */
+struct timeout_test
+  {
+    struct semaphore sema;      /* Semaphore waited on. */
+    struct lock lock;           /* Lock waited on. */
+    struct semaphore go;        /* Tells the lock holder to continue. */
+    int holder_priority;        /* Lock holder's priority after timeout. */
+  };
+
+static thread_func up_thread_func;
+static thread_func holder_thread_func;
+
+void
+test_sema_timeout (void) 
+{
+  struct timeout_test test;
+  int64_t start, elapsed;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&test.sema, 0);
+  lock_init (&test.lock);
+  sema_init (&test.go, 0);
+
+  /* Nobody ups the semaphore. */
+  start = timer_ticks ();
+  if (sema_down_timeout (&test.sema, TIMEOUT))
+    fail ("sema_down_timeout() succeeded on a semaphore nobody upped");
+  elapsed = timer_elapsed (start);
+  if (elapsed < TIMEOUT)
+    fail ("sema_down_timeout() gave up after %lld ticks", elapsed);
+  msg ("Semaphore wait timed out.");
+
+  /* Another thread ups the semaphore well before the timeout. */
+  thread_create ("up", PRI_DEFAULT, up_thread_func, &test);
+  start = timer_ticks ();
+  if (!sema_down_timeout (&test.sema, 100))
+    fail ("sema_down_timeout() timed out on a semaphore that was upped");
+  elapsed = timer_elapsed (start);
+  if (elapsed >= 100)
+    fail ("sema_down_timeout() took %lld ticks to succeed", elapsed);
+  msg ("Semaphore wait succeeded before the timeout.");
+
+  /* The holder starts out above us so that it grabs the lock
+     right away, then drops below us, so that we donate to it. */
+  thread_create ("holder", PRI_DEFAULT + 1, holder_thread_func, &test);
+  if (lock_acquire_timeout (&test.lock, TIMEOUT))
+    fail ("lock_acquire_timeout() acquired a held lock");
+  msg ("Lock wait timed out.");
+
+  /* Let the holder report its priority and release the lock. */
+  sema_up (&test.go);
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (PRI_DEFAULT);
+  msg ("Holder's priority after the timeout: %d.", test.holder_priority);
+
+  if (!lock_acquire_timeout (&test.lock, TIMEOUT))
+    fail ("lock_acquire_timeout() failed on a free lock");
+  lock_release (&test.lock);
+  msg ("Lock acquired once free.");
+}
+
+/* Ups the semaphore after sleeping for a tick. */
+static void
+up_thread_func (void *test_) 
+{
+  struct timeout_test *test = test_;
+
+  timer_sleep (1);
+  sema_up (&test->sema);
+}
+
+/* Acquires the lock and lowers its priority, then waits to be
+   told to record its priority and release the lock. */
+static void
+holder_thread_func (void *test_) 
+{
+  struct timeout_test *test = test_;
+
+  lock_acquire (&test->lock);
+  thread_set_priority (PRI_DEFAULT - 1);
+  sema_down (&test->go);
+  test->holder_priority = thread_get_priority ();
+  lock_release (&test->lock);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sema-timeout) begin
+(sema-timeout) Semaphore wait timed out.
+(sema-timeout) Semaphore wait succeeded before the timeout.
+(sema-timeout) Lock wait timed out.
+(sema-timeout) Holder's priority after the timeout: 30.
+(sema-timeout) Lock acquired once free.
+(sema-timeout) end
+EOF
+pass;
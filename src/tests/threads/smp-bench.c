@@ -0,0 +1,97 @@
+/* Measures how CPU-bound throughput scales with the number of
+   CPUs.
+
+   First one worker thread, then one per CPU, each run the same
+   fixed amount of computation with interrupts on.  The workers
+   are all created on the bootstrap processor, so they only run
+   in parallel if idle CPUs take them from its run queue.  With N
+   CPUs, N workers should finish in about the time that one takes
+   alone, for a speedup of about N.  Run with more than one CPU,
+   e.g. "pintos --qemu --smp=4". */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WORK_ITERS (1 << 25)    /* Loop iterations per worker. */
+
+/* Information shared by the workers. */
+struct smp_bench
+  {
+    struct semaphore done;      /* Upped by each worker when done. */
+    bool ran_on[MP_CPU_MAX];    /* CPUs that workers finished on. */
+  };
+
+static thread_func worker_thread;
+static int64_t run_workers (struct smp_bench *, int worker_cnt);
+
+void
+test_smp_bench (void)
+{
+  struct smp_bench bench;
+  int cpu_cnt = mp_cpu_cnt ();
+  int64_t one_ns, all_ns;
+  int used_cnt;
+  int i;
+
+  sema_init (&bench.done, 0);
+
+  one_ns = run_workers (&bench, 1);
+  for (i = 0; i < MP_CPU_MAX; i++)
+    bench.ran_on[i] = false;
+  all_ns = run_workers (&bench, cpu_cnt);
+
+  used_cnt = 0;
+  for (i = 0; i < MP_CPU_MAX; i++)
+    if (bench.ran_on[i])
+      used_cnt++;
+
+  msg ("%d CPUs.", cpu_cnt);
+  msg ("1 worker: %lld us.", one_ns / 1000);
+  msg ("%d workers: %lld us, on %d CPUs.", cpu_cnt, all_ns / 1000, used_cnt);
+  msg ("Speedup: %lld.%02lld.",
+       cpu_cnt * one_ns * 100 / all_ns / 100,
+       cpu_cnt * one_ns * 100 / all_ns % 100);
+}
+
+/* Runs WORKER_CNT workers to completion and returns the number
+   of nanoseconds they took. */
+static int64_t
+run_workers (struct smp_bench *bench, int worker_cnt)
+{
+  int64_t start;
+  int i;
+
+  start = timer_ns ();
+  for (i = 0; i < worker_cnt; i++)
+    if (thread_create ("worker", PRI_DEFAULT, worker_thread, bench)
+        == TID_ERROR)
+      fail ("couldn't create worker thread %d", i);
+  for (i = 0; i < worker_cnt; i++)
+    sema_down (&bench->done);
+  return timer_ns () - start;
+}
+
+/* Worker thread. */
+static void
+worker_thread (void *bench_)
+{
+  struct smp_bench *bench = bench_;
+  enum intr_level old_level;
+  volatile uint32_t x = 1;
+  int i;
+
+  for (i = 0; i < WORK_ITERS; i++)
+    x = x * 1103515245 + 12345;
+
+  old_level = intr_disable ();
+  bench->ran_on[thread_current ()->cpu] = true;
+  intr_set_level (old_level);
+
+  sema_up (&bench->done);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($cpus, $used, $speedup);
+foreach (@output) {
+    ($cpus) = /(\d+) CPUs\./ if !defined $cpus;
+    ($used) = /workers: \d+ us, on (\d+) CPUs/ if !defined $used;
+    ($speedup) = /Speedup: (\d+\.\d+)/ if !defined $speedup;
+}
+fail "missing throughput statistics\n"
+  if !defined $cpus || !defined $used || !defined $speedup;
+fail "ran with $cpus CPUs, expected 4\n" if $cpus != 4;
+fail "workers only ran on $used CPU\n" if $used < 2;
+fail "speedup of $speedup with $cpus CPUs\n" if $speedup < 1.5;
+pass;
@@ -1,4 +1,5 @@
 #include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
 #include <debug.h>
 #include <string.h>
 #include <stdio.h>
@@ -17,6 +18,9 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-bench", test_alarm_bench},
+    {"alarm-usleep", test_alarm_usleep},
+    {"alarm-tickless", test_alarm_tickless},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,10 +29,24 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-bench", test_priority_donate_bench},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-bench", test_priority_bench},
+    {"priority-sema-bench", test_priority_sema_bench},
+    {"thread-create-bench", test_thread_create_bench},
+    {"edf-periodic", test_edf_periodic},
+    {"workqueue", test_workqueue},
+    {"rwlock", test_rwlock},
+    {"rwlock-bench", test_rwlock_bench},
+    {"smp-bench", test_smp_bench},
+    {"trace", test_trace},
+    {"ktimer", test_ktimer},
+    {"ktimer-cascade", test_ktimer_cascade},
+    {"ktimer-bench", test_ktimer_bench},
+    {"sema-timeout", test_sema_timeout},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +56,14 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"bench-yield", test_bench_yield},
+    {"bench-sema", test_bench_sema},
+    {"bench-lock", test_bench_lock},
+    {"bench-create", test_bench_create},
+    {"bench-wakeup", test_bench_wakeup},
+    {"bench-printf", test_bench_printf},
   };
 
 static const char *test_name;
@@ -0,0 +1,52 @@
+/* Measures thread creation and exit throughput.
+
+   Each iteration creates a thread at a higher priority than the
+   main thread, so that it runs and exits immediately, before
+   thread_create() returns.  Its page is released as soon as the
+   main thread is scheduled again, ready for the next iteration's
+   thread_create() to reuse. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000         /* Threads created and exited. */
+
+static thread_func exit_thread;
+
+void
+test_thread_create_bench (void)
+{
+  uint64_t start_cycles, cycles;
+  int64_t start_ticks, ticks;
+  int exited = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  start_ticks = timer_ticks ();
+  start_cycles = timer_cycles ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if (thread_create ("exiter", PRI_DEFAULT + 1, exit_thread, &exited)
+        == TID_ERROR)
+      fail ("thread_create() failed on iteration %d", i);
+  cycles = timer_cycles () - start_cycles;
+  ticks = timer_elapsed (start_ticks);
+
+  if (exited != THREAD_CNT)
+    fail ("only %d of %d threads ran", exited, THREAD_CNT);
+
+  msg ("Created and exited %d threads in %lld ticks.", THREAD_CNT, ticks);
+  msg ("%llu cycles per thread create and exit.", cycles / THREAD_CNT);
+}
+
+/* Counts itself and exits. */
+static void
+exit_thread (void *exited_)
+{
+  int *exited = exited_;
+  (*exited)++;
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing thread count\n"
+  if !grep (/Created and exited 2000 threads in \d+ ticks/, @output);
+fail "missing cycle count\n"
+  if !grep (/\d+ cycles per thread create and exit/, @output);
+pass;
@@ -0,0 +1,118 @@
+/* Turns on the scheduler event trace, runs a semaphore ping-pong
+   and a contended lock handoff, and checks that the trace
+   recorded the context switches, wakeups, lock events, and timer
+   ticks in the order they happened. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 10            /* Ping-pong round trips. */
+
+static struct semaphore ping, pong;
+static struct lock lock;
+
+static thread_func pong_thread;
+static thread_func locker_thread;
+
+void
+test_trace (void)
+{
+  struct trace_record r;
+  tid_t pong_tid, locker_tid;
+  int switch_cnt, wakeup_cnt, tick_cnt;
+  int step;
+  uint64_t last_tsc;
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  lock_init (&lock);
+  pong_tid = thread_create ("pong", PRI_DEFAULT + 1, pong_thread, NULL);
+
+  if (!trace_start ())
+    fail ("couldn't allocate trace buffer");
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+
+  lock_acquire (&lock);
+  locker_tid = thread_create ("locker", PRI_DEFAULT + 1, locker_thread, NULL);
+  lock_release (&lock);
+
+  timer_sleep (2);
+  trace_stop ();
+
+  /* Scan the trace. */
+  switch_cnt = wakeup_cnt = tick_cnt = 0;
+  step = 0;
+  last_tsc = 0;
+  for (i = 0; i < trace_size (); i++)
+    {
+      trace_get (i, &r);
+      if (r.tsc < last_tsc)
+        fail ("record %zu goes back in time", i);
+      last_tsc = r.tsc;
+
+      if (r.type == TRACE_SWITCH && r.arg == (uint32_t) pong_tid)
+        switch_cnt++;
+      else if (r.type == TRACE_WAKEUP && r.arg == (uint32_t) pong_tid)
+        wakeup_cnt++;
+      else if (r.type == TRACE_TICK)
+        tick_cnt++;
+      else if (r.arg == (uint32_t) &lock)
+        {
+          /* Expect the locker to wait, us to release, and the
+             locker to acquire and release, in that order. */
+          if (step == 0 && r.type == TRACE_LOCK_WAIT && r.tid == locker_tid
+              && r.arg2 == (uint32_t) thread_tid ())
+            step++;
+          else if (step == 1 && r.type == TRACE_LOCK_RELEASE
+                   && r.tid == thread_tid ())
+            step++;
+          else if (step == 2 && r.type == TRACE_LOCK_ACQUIRE
+                   && r.tid == locker_tid)
+            step++;
+          else if (step == 3 && r.type == TRACE_LOCK_RELEASE
+                   && r.tid == locker_tid)
+            step++;
+        }
+    }
+
+  msg ("pong switched in %d times, woken %d times.", switch_cnt, wakeup_cnt);
+  if (step != 4)
+    fail ("lock handoff not traced in order (step %d)", step);
+  msg ("Lock handoff traced in order.");
+  if (tick_cnt == 0)
+    fail ("no timer ticks traced");
+  msg ("Timer ticks traced.");
+}
+
+static void
+pong_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
+
+static void
+locker_thread (void *aux UNUSED)
+{
+  lock_acquire (&lock);
+  lock_release (&lock);
+}
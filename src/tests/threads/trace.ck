@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(trace) begin
+(trace) pong switched in 10 times, woken 10 times.
+(trace) Lock handoff traced in order.
+(trace) Timer ticks traced.
+(trace) end
+EOF
+pass;
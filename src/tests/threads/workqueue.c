@@ -0,0 +1,96 @@
+/* Checks that work items queued with interrupts off, as an
+   interrupt handler would queue them, start in the order they
+   were queued, that queuing an item that is already pending has
+   no effect, and that an item that queues itself again while it
+   runs is never run by two worker threads at once. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 16             /* Number of independent items. */
+#define REQUEUE_CNT 10          /* Runs of the self-requeuing item. */
+
+static struct work items[ITEM_CNT];
+static int order[ITEM_CNT];     /* Item indexes, in order started. */
+static int started;             /* Number of items started. */
+static struct semaphore done;
+
+static struct work requeue_item;
+static int requeue_runs;        /* Times requeue_item has run. */
+static int active;              /* Instances of requeue_func running. */
+static bool concurrent;         /* Did requeue_func ever overlap? */
+
+static work_func record_func;
+static work_func requeue_func;
+
+void
+test_workqueue (void) 
+{
+  enum intr_level old_level;
+  int i;
+
+  /* Run at the workers' priority, so that queuing work does not
+     preempt us. */
+  thread_set_priority (PRI_MAX);
+  sema_init (&done, 0);
+
+  for (i = 0; i < ITEM_CNT; i++)
+    work_init (&items[i], record_func, (void *) i);
+
+  old_level = intr_disable ();
+  for (i = 0; i < ITEM_CNT; i++)
+    if (!work_queue (&items[i]))
+      fail ("item %d was not queued", i);
+  if (work_queue (&items[0]))
+    fail ("pending item was queued twice");
+  intr_set_level (old_level);
+
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < ITEM_CNT; i++)
+    if (order[i] != i)
+      fail ("item %d started in position %d", order[i], i);
+  msg ("%d work items started in the order queued.", ITEM_CNT);
+
+  work_init (&requeue_item, requeue_func, NULL);
+  work_queue (&requeue_item);
+  sema_down (&done);
+  if (concurrent)
+    fail ("self-requeuing item ran concurrently");
+  msg ("Self-requeuing item ran %d times, never concurrently.",
+       requeue_runs);
+}
+
+/* Records that item number AUX has started. */
+static void
+record_func (void *aux) 
+{
+  enum intr_level old_level = intr_disable ();
+  order[started++] = (int) aux;
+  intr_set_level (old_level);
+
+  sema_up (&done);
+}
+
+/* Queues itself again and then yields, giving the other worker
+   a chance to pick up the new instance while this one is still
+   running, until it has run REQUEUE_CNT times. */
+static void
+requeue_func (void *aux UNUSED) 
+{
+  if (++active > 1)
+    concurrent = true;
+
+  if (++requeue_runs < REQUEUE_CNT)
+    work_queue (&requeue_item);
+  thread_yield ();
+
+  active--;
+  if (requeue_runs == REQUEUE_CNT)
+    sema_up (&done);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) 16 work items started in the order queued.
+(workqueue) Self-requeuing item ran 10 times, never concurrently.
+(workqueue) end
+EOF
+pass;
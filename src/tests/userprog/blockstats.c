@@ -0,0 +1,61 @@
+/* Reads a file, then checks that the I/O statistics of every
+   block device are consistent and that some device counted the
+   reads.  Also checks that asking about a nonexistent device
+   fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Checks the statistics X for transfers in direction NAME on
+   DEV.  Returns the number of requests. */
+static uint64_t
+check_xfer (const char *dev, const char *name,
+            const struct block_xfer_stats *x)
+{
+  uint64_t bucket_sum = 0;
+  int i;
+
+  for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+    bucket_sum += x->latency[i];
+  if (bucket_sum != x->requests)
+    fail ("%s: %s latency histogram does not add up", dev, name);
+  if (x->bytes % 512 != 0 || (x->bytes == 0) != (x->requests == 0))
+    fail ("%s: %s byte count is wrong", dev, name);
+  if (x->sequential + x->random < x->requests)
+    fail ("%s: more %s requests completed than submitted", dev, name);
+  return x->requests;
+}
+
+void
+test_main (void) 
+{
+  struct block_stats stats;
+  uint64_t reads = 0;
+  char buf[1024];
+  int dev, fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (fd, buf, sizeof buf) > 0, "read \"sample.txt\"");
+  close (fd);
+
+  for (dev = 0; blockstats (dev, &stats); dev++)
+    {
+      uint64_t depth_sum = 0;
+      int i;
+
+      reads += check_xfer (stats.name, "read", &stats.read);
+      check_xfer (stats.name, "write", &stats.write);
+      for (i = 0; i < BLOCK_DEPTH_BUCKETS; i++)
+        depth_sum += stats.depth[i];
+      if (depth_sum != (stats.read.sequential + stats.read.random
+                        + stats.write.sequential + stats.write.random))
+        fail ("%s: queue depth samples do not add up", stats.name);
+    }
+  if (reads == 0)
+    fail ("no block device counted any reads");
+  msg ("block device statistics are consistent");
+
+  CHECK (!blockstats (-1, &stats), "blockstats (-1)");
+  CHECK (!blockstats (dev, &stats), "blockstats (past last device)");
+}
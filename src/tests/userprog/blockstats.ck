@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(blockstats) begin
+(blockstats) open "sample.txt"
+(blockstats) read "sample.txt"
+(blockstats) block device statistics are consistent
+(blockstats) blockstats (-1)
+(blockstats) blockstats (past last device)
+(blockstats) end
+blockstats: exit(0)
+EOF
+pass;
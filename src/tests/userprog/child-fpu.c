@@ -0,0 +1,16 @@
+/* Child process run by fpu-switch.  Uses a different x87
+   rounding mode from its parent and exits with status 0 if the
+   mode never changes. */
+
+#include "tests/lib.h"
+#include "tests/userprog/rounding.h"
+
+int
+main (void) 
+{
+  test_name = "child-fpu";
+
+  set_rounding (ROUND_DOWN);
+  check_rounding (ROUND_DOWN, 20);
+  return 0;
+}
@@ -0,0 +1,36 @@
+/* Reads the high-resolution clock and checks that it runs
+   forward and resolves intervals much shorter than a timer
+   tick. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Length of a 100 Hz timer tick, in nanoseconds. */
+#define TICK_NS (10 * 1000 * 1000)
+
+void
+test_main (void) 
+{
+  int64_t start, now, step;
+
+  start = clock_ns ();
+  if (start <= 0)
+    fail ("clock_ns() returned %lld", start);
+
+  /* Wait for the clock to move, and see how far it moved. */
+  do
+    now = clock_ns ();
+  while (now == start);
+  step = now - start;
+  if (step < 0)
+    fail ("clock went backward by %lld ns", -step);
+  if (step >= TICK_NS / 10)
+    fail ("clock advanced in steps of %lld ns", step);
+  msg ("clock resolves less than a tenth of a tick");
+
+  /* Run for a while and check that the clock keeps up. */
+  while (clock_ns () - start < 2 * TICK_NS)
+    continue;
+  msg ("clock advanced through two ticks");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock) begin
+(clock) clock resolves less than a tenth of a tick
+(clock) clock advanced through two ticks
+(clock) end
+clock: exit(0)
+EOF
+pass;
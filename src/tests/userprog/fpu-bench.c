@@ -0,0 +1,90 @@
+/* Multiplies two matrices of ints and then two matrices of
+   doubles, using the hardware FPU for the latter, and reports
+   how many timer ticks each multiplication took.  The first FPU
+   instruction traps so that the kernel can load this process's
+   FPU state; after that, floating-point arithmetic runs at
+   hardware speed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DIM 128
+
+/* The int and double matrices share memory, since they are not
+   needed at the same time. */
+static union
+  {
+    int i[3][DIM][DIM];
+    double d[3][DIM][DIM];
+  }
+m;
+
+/* Returns the number of timer ticks this process has run. */
+static int64_t
+run_ticks (void)
+{
+  struct thread_stats stats;
+
+  if (!schedstats (0, &stats))
+    fail ("schedstats failed");
+  return stats.run_ticks;
+}
+
+static void
+int_matmult (void)
+{
+  int (*a)[DIM] = m.i[0], (*b)[DIM] = m.i[1], (*c)[DIM] = m.i[2];
+  int i, j, k;
+
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+        a[i][j] = i;
+        b[i][j] = j;
+        c[i][j] = 0;
+      }
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      for (k = 0; k < DIM; k++)
+        c[i][j] += a[i][k] * b[k][j];
+  if (c[DIM - 1][DIM - 1] != DIM * (DIM - 1) * (DIM - 1))
+    fail ("int result %d is wrong", c[DIM - 1][DIM - 1]);
+}
+
+static void
+double_matmult (void)
+{
+  double (*a)[DIM] = m.d[0], (*b)[DIM] = m.d[1], (*c)[DIM] = m.d[2];
+  int i, j, k;
+
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+        a[i][j] = i * 0.5;
+        b[i][j] = j * 2.0;
+        c[i][j] = 0.0;
+      }
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      for (k = 0; k < DIM; k++)
+        c[i][j] += a[i][k] * b[k][j];
+  if (c[DIM - 1][DIM - 1] != DIM * (DIM - 1) * (DIM - 1))
+    fail ("double result is wrong");
+}
+
+void
+test_main (void) 
+{
+  int64_t start;
+
+  start = run_ticks ();
+  int_matmult ();
+  msg ("int matmult (%dx%d): %d ticks", DIM, DIM,
+       (int) (run_ticks () - start));
+
+  start = run_ticks ();
+  double_matmult ();
+  msg ("double matmult (%dx%d): %d ticks", DIM, DIM,
+       (int) (run_ticks () - start));
+}
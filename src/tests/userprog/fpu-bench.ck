@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing int matmult time\n"
+  if !grep (/int matmult \(128x128\): \d+ ticks/, @output);
+fail "missing double matmult time\n"
+  if !grep (/double matmult \(128x128\): \d+ ticks/, @output);
+fail "fpu-bench did not exit normally\n"
+  if !grep (/^fpu-bench: exit\(0\)$/, @output);
+pass;
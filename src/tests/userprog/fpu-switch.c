@@ -0,0 +1,23 @@
+/* Runs this process and a child process at the same time, with
+   different x87 rounding modes, and checks that neither
+   process's FPU state leaks into the other's across context
+   switches. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rounding.h"
+
+void
+test_main (void) 
+{
+  pid_t child;
+
+  set_rounding (ROUND_UP);
+  child = exec ("child-fpu");
+  if (child == PID_ERROR)
+    fail ("exec (\"child-fpu\") failed");
+  check_rounding (ROUND_UP, 20);
+  msg ("parent kept its rounding mode");
+  CHECK (wait (child) == 0, "wait for child");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-switch) begin
+child-fpu: exit(0)
+(fpu-switch) parent kept its rounding mode
+(fpu-switch) wait for child
+(fpu-switch) end
+fpu-switch: exit(0)
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Helpers for tests that check that each process keeps its own
+   x87 FPU state, using the rounding mode in the FPU control
+   word as a marker that is easy to observe. */
+
+#include "tests/userprog/rounding.h"
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Sets the FPU's rounding mode to MODE, one of the ROUND_*
+   values. */
+void
+set_rounding (unsigned mode)
+{
+  uint16_t cw;
+
+  asm volatile ("fnstcw %0" : "=m" (cw));
+  cw = (cw & ~ROUND_ZERO) | mode;
+  asm volatile ("fldcw %0" : : "m" (cw));
+}
+
+/* Returns X rounded to an integer in the current rounding
+   mode. */
+static int
+round_int (double x)
+{
+  int result;
+
+  asm volatile ("fldl %1; fistpl %0" : "=m" (result) : "m" (x));
+  return result;
+}
+
+/* Repeatedly checks that the FPU's rounding mode is MODE, which
+   must be ROUND_UP or ROUND_DOWN, until this process has run
+   for TICKS timer ticks, long enough to be preempted several
+   times.  Fails if the rounding mode ever changes. */
+void
+check_rounding (unsigned mode, int ticks)
+{
+  int expect_pos = mode == ROUND_UP ? 3 : 2;
+  int expect_neg = mode == ROUND_UP ? -2 : -3;
+  struct thread_stats stats;
+  int64_t start;
+
+  if (!schedstats (0, &stats))
+    fail ("schedstats failed");
+  start = stats.run_ticks;
+  do
+    {
+      int pos = round_int (2.5);
+      int neg = round_int (-2.5);
+      if (pos != expect_pos || neg != expect_neg)
+        fail ("2.5 and -2.5 rounded to %d and %d, expected %d and %d",
+              pos, neg, expect_pos, expect_neg);
+      if (!schedstats (0, &stats))
+        fail ("schedstats failed");
+    }
+  while (stats.run_ticks - start < ticks);
+}
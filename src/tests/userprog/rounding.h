@@ -0,0 +1,13 @@
+#ifndef TESTS_USERPROG_ROUNDING_H
+#define TESTS_USERPROG_ROUNDING_H
+
+/* x87 rounding modes, as encoded in the FPU control word. */
+#define ROUND_NEAREST 0x0000
+#define ROUND_DOWN 0x0400
+#define ROUND_UP 0x0800
+#define ROUND_ZERO 0x0c00
+
+void set_rounding (unsigned mode);
+void check_rounding (unsigned mode, int ticks);
+
+#endif /* tests/userprog/rounding.h */
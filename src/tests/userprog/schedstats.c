@@ -0,0 +1,19 @@
+/* Reads this process's scheduling statistics, and checks that
+   asking about a nonexistent process fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct thread_stats stats;
+
+  CHECK (schedstats (0, &stats), "schedstats (0)");
+  if (stats.run_ticks < 0 || stats.ready_ticks < 0
+      || stats.blocked_ticks < 0)
+    fail ("negative time in scheduling statistics");
+  CHECK (!schedstats ((pid_t) 0x0c020301, &stats),
+         "schedstats (bad pid)");
+}
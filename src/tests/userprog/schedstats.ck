@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstats) begin
+(schedstats) schedstats (0)
+(schedstats) schedstats (bad pid)
+(schedstats) end
+schedstats: exit(0)
+EOF
+pass;
@@ -10,6 +10,7 @@
 #include <string.h>
 #include "devices/kbd.h"
 #include "devices/input.h"
+#include "devices/pci.h"
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
@@ -19,12 +20,16 @@
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/fpu.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -34,6 +39,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/virtio-blk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -52,6 +59,9 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -ramdisk: Size of RAM disk to create, in bytes, or 0 for none. */
+static size_t ramdisk_size;
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -66,6 +76,7 @@ static void run_actions (char **argv);
 static void usage (void);
 
 #ifdef FILESYS
+static size_t parse_size (const char *);
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
 #endif
@@ -98,6 +109,11 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  trace_init ();
+
+  /* Find the other CPUs. */
+  mp_init ();
+  mp_print_config ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -107,22 +123,31 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  workqueue_init ();
   timer_init ();
   kbd_init ();
   input_init ();
+  pci_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  fpu_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_start ();
   serial_init_queue ();
   timer_calibrate ();
 
+  /* Start the other CPUs. */
+  mp_start ();
+
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  virtio_blk_init ();
+  ramdisk_init (ramdisk_size);
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -247,6 +272,12 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-pio"))
+        ide_pio = true;
+      else if (!strcmp (name, "-fifo"))
+        block_fifo = true;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_size = parse_size (value);
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -256,6 +287,12 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-trace"))
+        trace_boot = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -263,6 +300,8 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("-mlfqs and -cfs are mutually exclusive");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -373,12 +412,18 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -pio               Use programmed I/O, not DMA, for IDE disks.\n"
+          "  -fifo              Send disk requests in arrival order, unmerged.\n"
+          "  -ramdisk=SIZE      Add RAM disk ram0 of SIZE kB, or SIZEM MB.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler.\n"
+          "  -tickless          Stop the timer interrupt while idle.\n"
+          "  -trace             Record scheduler events, dump at shutdown.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -387,6 +432,23 @@ usage (void)
 }
 
 #ifdef FILESYS
+/* Parses SIZE, a number of kB or, with an "M" suffix, of MB, and
+   returns it in bytes. */
+static size_t
+parse_size (const char *size)
+{
+  const char *end;
+  size_t n = 0;
+
+  if (size == NULL)
+    PANIC ("option requires a size");
+  for (end = size; *end >= '0' && *end <= '9'; end++)
+    n = n * 10 + (*end - '0');
+  if (end == size || (*end != '\0' && strcmp (end, "M")))
+    PANIC ("bad size `%s'", size);
+  return *end == 'M' ? n * 1024 * 1024 : n * 1024;
+}
+
 /* Figure out what block devices to cast in the various Pintos roles. */
 static void
 locate_block_devices (void)
@@ -6,8 +6,11 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/mp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -43,9 +46,33 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU handles its own external
+   interrupts, so these are kept per CPU. */
+static bool in_external_intr[MP_CPU_MAX]; /* Processing an external interrupt? */
+static bool yield_on_return[MP_CPU_MAX];  /* Yield on interrupt return? */
+
+/* Interrupt lock.
+
+   On a single CPU, turning interrupts off keeps any other code
+   from running, and the kernel relies on that for mutual
+   exclusion everywhere: in the scheduler, in synch.c, and in
+   most device drivers.  Once other CPUs are running, that is no
+   longer enough, so a CPU that turns interrupts off with
+   intr_disable() also takes this lock, and releases it when it
+   turns them back on.  Critical sections under intr_disable()
+   still exclude each other on every CPU, while code that runs
+   with interrupts on, which must already cope with being
+   preempted at any instruction, runs on all CPUs in parallel.
+
+   Thus, a CPU holds the lock just when its interrupts are off,
+   except inside a spinlock (see synch.c).  Interrupt handlers
+   entered with interrupts on take the lock on entry and release
+   it on return, and a thread switch, which happens with
+   interrupts off, hands the lock from the old thread to the new
+   one.  Until intr_start_locking() is called the lock is not
+   used at all, so a uniprocessor pays nothing for it. */
+static struct spinlock intr_lock;
+static bool intr_locking;       /* Is the interrupt lock in use? */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -56,8 +83,13 @@ static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 
+/* Interrupt lock helpers. */
+static void intr_lock_acquire (void);
+static void intr_lock_release (void);
+
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
+static bool is_external (uint8_t vec_no);
 static void unexpected_interrupt (const struct intr_frame *);
 
 /* Returns the current interrupt status. */
@@ -94,6 +126,8 @@ intr_enable (void)
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
      Hardware Interrupts". */
+  if (old_level == INTR_OFF)
+    intr_lock_release ();
   asm volatile ("sti");
 
   return old_level;
@@ -109,9 +143,33 @@ intr_disable (void)
      See [IA32-v2b] "CLI" and [IA32-v3a] 5.8.1 "Masking Maskable
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
+  if (old_level == INTR_ON)
+    intr_lock_acquire ();
 
   return old_level;
 }
+
+/* Turns interrupts on and waits for the next one, for the idle
+   thread.  Interrupts must be off.
+
+   The `sti' instruction disables interrupts until the
+   completion of the next instruction, so the `sti' and `hlt'
+   here are executed atomically.  This atomicity is important;
+   otherwise, an interrupt could be handled between re-enabling
+   interrupts and waiting for the next one to occur, wasting as
+   much as one clock tick worth of time.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
+   7.11.1 "HLT Instruction". */
+void
+intr_wait (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!intr_context ());
+
+  intr_lock_release ();
+  asm volatile ("sti; hlt" : : : "memory");
+}
 
 /* Initializes the interrupt system. */
 void
@@ -157,6 +215,49 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT into an application processor, which mp.c has
+   just started.  The CPU starts with interrupts off, so this
+   also takes the interrupt lock, as intr_disable() would have. */
+void
+intr_init_ap (void)
+{
+  uint64_t idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  intr_lock_acquire ();
+}
+
+/* Starts using the interrupt lock.  Called by the bootstrap
+   processor, with interrupts on, before it starts any other
+   CPU. */
+void
+intr_start_locking (void)
+{
+  ASSERT (intr_get_level () == INTR_ON);
+
+  intr_locking = true;
+}
+
+/* Takes the interrupt lock, if it is in use.  Interrupts must be
+   off. */
+static void
+intr_lock_acquire (void)
+{
+  if (intr_locking)
+    spinlock_lock (&intr_lock);
+}
+
+/* Releases the interrupt lock, if it is in use.  Interrupts must
+   be off. */
+static void
+intr_lock_release (void)
+{
+  if (intr_locking)
+    spinlock_unlock (&intr_lock);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -176,12 +277,14 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  External interrupts are
+   those from the PICs, 0x20...0x2f, and from the local APIC,
+   0xf0...0xff. */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_external (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,16 +305,18 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
 /* Returns true during processing of an external interrupt
-   and false at all other times. */
+   and false at all other times.  The running thread cannot move
+   to another CPU while interrupts are off, so the per-CPU flag
+   only needs to be read then. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  return intr_get_level () == INTR_OFF && in_external_intr[mp_cpu_id ()];
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +327,7 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  yield_on_return[mp_cpu_id ()] = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -346,26 +451,40 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  int cpu = 0;
+
+  /* An interrupt gate turned interrupts off.  If they were on in
+     the interrupted code, take the interrupt lock, as
+     intr_disable() would have. */
+  if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+    intr_lock_acquire ();
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
+     and they need to be acknowledged on the PIC or the local
+     APIC (see below).
      An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  external = is_external (frame->vec_no);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      cpu = mp_cpu_id ();
+      in_external_intr[cpu] = true;
+      yield_on_return[cpu] = false;
+
+      /* If the CPU was idling without timer ticks, catch the
+         clock up before anything looks at it. */
+      timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_SPURIOUS_VEC)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -380,12 +499,33 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      in_external_intr[cpu] = false;
+      if (frame->vec_no < LAPIC_VEC_BASE)
+        pic_end_of_interrupt (frame->vec_no); 
+      else if (frame->vec_no != LAPIC_SPURIOUS_VEC)
+        lapic_eoi ();
 
-      if (yield_on_return) 
-        thread_yield (); 
+      if (yield_on_return[cpu]) 
+        thread_preempt (); 
     }
+
+  /* Returning restores the interrupted code's interrupt flag.
+     Release or take the interrupt lock to match. */
+  if (frame->eflags & FLAG_IF)
+    {
+      if (intr_get_level () == INTR_OFF)
+        intr_lock_release ();
+    }
+  else if (intr_get_level () == INTR_ON)
+    intr_disable ();
+}
+
+/* Returns true if VEC_NO is an external interrupt, one from the
+   PICs or the local APIC, false if it is internal. */
+static bool
+is_external (uint8_t vec_no)
+{
+  return (vec_no >= 0x20 && vec_no < 0x30) || vec_no >= LAPIC_VEC_BASE;
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
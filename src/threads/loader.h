@@ -18,6 +18,12 @@
 #define LOADER_ARGS (LOADER_PARTS - LOADER_ARGS_LEN)   /* Command-line args. */
 #define LOADER_ARG_CNT (LOADER_ARGS - LOADER_ARG_CNT_LEN) /* Number of args. */
 
+/* Physical address to which the application processors'
+   startup code, ap_start in start.S, is copied.  A startup IPI
+   can only start a CPU in real mode on a page boundary below
+   1 MB, and this page is otherwise unused after boot. */
+#define AP_START_PHYS 0x8000
+
 /* Sizes of loader data structures. */
 #define LOADER_SIG_LEN 2
 #define LOADER_PARTS_LEN 64
@@ -0,0 +1,388 @@
+#include "threads/mp.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <packed.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/fpu.h"
+#include "userprog/gdt.h"
+#endif
+
+/* Multiprocessor support.
+
+   At boot, mp_init() finds the MP floating pointer structure left
+   in low memory by the BIOS and walks the MP configuration table
+   it points to, recording the processors, their local APIC IDs,
+   and the addresses of the local and I/O APICs.  See the Intel
+   MultiProcessor Specification, version 1.4, chapter 4.
+
+   Later, mp_start() starts the application processors (APs),
+   all but the bootstrap processor (BSP) that booted Pintos, one
+   at a time.  Each AP begins in real mode at ap_start in
+   start.S, which switches it to protected mode with paging and
+   calls mp_ap_main() on the stack of an idle thread that the BSP
+   created for it.  From there it joins the scheduler, taking
+   threads from the other CPUs' run queues (see thread.c).
+
+   Each CPU is known by an index between 0 and mp_cpu_cnt() - 1.
+   The BSP is CPU 0.  Device interrupts all go to the BSP, through
+   the 8259A PICs; the I/O APICs are only detected. */
+
+/* MP floating pointer structure. */
+struct mp_float
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config_paddr;      /* Physical address of config table. */
+    uint8_t length;             /* Length in 16-byte units (1). */
+    uint8_t spec_rev;           /* MP spec revision. */
+    uint8_t checksum;           /* All bytes sum to 0. */
+    uint8_t features[5];        /* Nonzero features[0]: default config. */
+  }
+PACKED;
+
+/* MP configuration table header. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Base table length, in bytes. */
+    uint8_t spec_rev;           /* MP spec revision. */
+    uint8_t checksum;           /* All bytes sum to 0. */
+    char oem_id[8];             /* OEM identifier. */
+    char product_id[12];        /* Product identifier. */
+    uint32_t oem_table_paddr;   /* OEM table, or 0. */
+    uint16_t oem_table_size;    /* OEM table size. */
+    uint16_t entry_cnt;         /* Number of entries after header. */
+    uint32_t lapic_paddr;       /* Local APIC address. */
+    uint16_t ext_length;        /* Extended table length. */
+    uint8_t ext_checksum;       /* Extended table checksum. */
+    uint8_t reserved;
+  }
+PACKED;
+
+/* MP configuration table entry types. */
+enum mp_entry_type
+  {
+    MP_PROCESSOR = 0,           /* Processor, 20 bytes. */
+    MP_BUS = 1,                 /* Bus, 8 bytes. */
+    MP_IOAPIC = 2,              /* I/O APIC, 8 bytes. */
+    MP_IOINTR = 3,              /* I/O interrupt assignment, 8 bytes. */
+    MP_LINTR = 4                /* Local interrupt assignment, 8 bytes. */
+  };
+
+/* Processor entry. */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t lapic_id;           /* Local APIC ID. */
+    uint8_t lapic_version;      /* Local APIC version. */
+    uint8_t flags;              /* MP_CPU_* flags. */
+    uint32_t signature;         /* CPU stepping, model, family. */
+    uint32_t feature_flags;     /* CPUID feature flags. */
+    uint32_t reserved[2];
+  }
+PACKED;
+
+#define MP_CPU_ENABLED 0x01     /* Processor is usable. */
+
+/* I/O APIC entry. */
+struct mp_ioapic
+  {
+    uint8_t type;               /* MP_IOAPIC. */
+    uint8_t id;                 /* I/O APIC ID. */
+    uint8_t version;            /* I/O APIC version. */
+    uint8_t flags;              /* Bit 0: usable. */
+    uint32_t paddr;             /* I/O APIC address. */
+  }
+PACKED;
+
+/* Discovered configuration. */
+static int found_cnt = 1;                       /* Number of CPUs. */
+static uint8_t found_lapic_ids[MP_CPU_MAX];     /* Local APIC IDs. */
+static uint32_t lapic_paddr;                    /* Local APIC address. */
+static uint32_t ioapic_paddr;                   /* First I/O APIC address. */
+static int ioapic_cnt;                          /* Number of I/O APICs. */
+static bool mp_found;                           /* MP tables found? */
+
+/* Running CPUs.  An AP increments cpu_cnt as it starts up, with
+   the interrupt lock held. */
+static volatile int cpu_cnt = 1;                /* Number of CPUs. */
+static uint8_t cpu_lapic_ids[MP_CPU_MAX];       /* Local APIC IDs. */
+
+/* AP startup code in start.S, which mp_start() copies to
+   AP_START_PHYS, and the variables in it that mp_start() fills
+   in: the physical address of the page directory to start with,
+   and the initial stack pointer. */
+extern char ap_start[], ap_end[], ap_cr3[], ap_esp[];
+
+void mp_ap_main (void) NO_RETURN;
+static void start_ap (uint8_t lapic_id, uint8_t *code);
+static intr_handler_func timer_interrupt, reschedule_interrupt;
+static struct mp_float *find_float (void);
+static struct mp_float *search (uintptr_t paddr, size_t size);
+static bool checksum_ok (const void *, size_t size);
+static void parse_config (const struct mp_config *);
+
+/* Looks for MP configuration tables and records the CPUs and
+   APICs they describe.  If there are none, the machine is
+   treated as a uniprocessor. */
+void
+mp_init (void)
+{
+  struct mp_float *mpf = find_float ();
+  if (mpf == NULL)
+    return;
+
+  mp_found = true;
+  if (mpf->features[0] != 0)
+    {
+      /* One of the MP spec's default configurations: two CPUs
+         with APIC IDs 0 and 1 and APICs at the default
+         addresses. */
+      found_cnt = 2;
+      found_lapic_ids[0] = 0;
+      found_lapic_ids[1] = 1;
+      lapic_paddr = 0xfee00000;
+      ioapic_paddr = 0xfec00000;
+      ioapic_cnt = 1;
+    }
+  else if (mpf->config_paddr != 0
+           && mpf->config_paddr < init_ram_pages * PGSIZE)
+    parse_config (ptov (mpf->config_paddr));
+}
+
+/* Starts the application processors that mp_init() found and
+   waits for each of them to start running threads.  Must be
+   called by the BSP, with interrupts on, after timer_calibrate()
+   and before any user process is created. */
+void
+mp_start (void)
+{
+  uint32_t *pd;
+  uint8_t *code;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (found_cnt == 1)
+    return;
+
+  lapic_init (lapic_paddr);
+  cpu_lapic_ids[0] = lapic_id ();   /* The BSP's. */
+  intr_register_ext (LAPIC_TIMER_VEC, timer_interrupt, "Local APIC Timer");
+  intr_register_ext (LAPIC_IPI_VEC, reschedule_interrupt, "Reschedule IPI");
+
+  /* The APs start with a copy of the kernel's page directory
+     that also maps the low 4 MB of physical memory, where
+     ap_start runs, at virtual address 0. */
+  pd = palloc_get_page (PAL_ASSERT);
+  memcpy (pd, init_page_dir, PGSIZE);
+  pd[0] = init_page_dir[pd_no (ptov (0))];
+
+  code = ptov (AP_START_PHYS);
+  memcpy (code, ap_start, ap_end - ap_start);
+  *(uint32_t *) (code + (ap_cr3 - ap_start)) = vtop (pd);
+
+  intr_start_locking ();
+  for (i = 0; i < found_cnt && cpu_cnt < MP_CPU_MAX; i++)
+    if (found_lapic_ids[i] != cpu_lapic_ids[0])
+      start_ap (found_lapic_ids[i], code);
+
+  palloc_free_page (pd);
+  printf ("MP: %d CPUs running\n", cpu_cnt);
+}
+
+/* Returns the number of CPUs running Pintos. */
+int
+mp_cpu_cnt (void)
+{
+  return cpu_cnt;
+}
+
+/* Returns the index, between 0 and mp_cpu_cnt() - 1, of the CPU
+   that is executing this function.  The running thread may move
+   to another CPU whenever interrupts are on, so the result is
+   only meaningful while they are off. */
+int
+mp_cpu_id (void)
+{
+  return cpu_cnt > 1 ? thread_current ()->cpu : 0;
+}
+
+/* Interrupts CPU, so that if it is idle it looks for threads to
+   run. */
+void
+mp_send_reschedule (int cpu)
+{
+  ASSERT (cpu >= 0 && cpu < cpu_cnt);
+
+  lapic_send_ipi (cpu_lapic_ids[cpu], LAPIC_IPI_VEC);
+}
+
+/* Prints the multiprocessor configuration. */
+void
+mp_print_config (void)
+{
+  if (!mp_found)
+    printf ("MP: no MP configuration table, assuming 1 CPU\n");
+  else
+    printf ("MP: %d CPU(s), local APIC at %#"PRIx32", "
+            "%d I/O APIC(s) at %#"PRIx32"\n",
+            found_cnt, lapic_paddr, ioapic_cnt, ioapic_paddr);
+}
+
+/* Starts the AP whose local APIC ID is LAPIC_ID, with the
+   startup code at CODE, and waits for it to report in. */
+static void
+start_ap (uint8_t lapic_id, uint8_t *code)
+{
+  int cpu = cpu_cnt;
+  struct thread *idle = thread_create_idle (cpu);
+  int64_t start;
+
+  cpu_lapic_ids[cpu] = lapic_id;
+  *(uint32_t *) (code + (ap_esp - ap_start)) = (uint32_t) idle + PGSIZE;
+  lapic_start_ap (lapic_id, AP_START_PHYS);
+
+  start = timer_ticks ();
+  while (cpu_cnt == cpu)
+    if (timer_elapsed (start) > TIMER_FREQ)
+      PANIC ("CPU with local APIC ID %d did not start", lapic_id);
+}
+
+/* Entered from ap_start in start.S, on a newly started AP, with
+   interrupts off, on the stack of the idle thread that
+   start_ap() created for it. */
+void
+mp_ap_main (void)
+{
+  /* Drop the startup page directory, which the BSP frees once
+     every AP has started. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  intr_init_ap ();
+
+  /* Count ourselves in, so that mp_cpu_id() starts looking at
+     the running thread's CPU number, which the rest of the
+     setup needs, and so that mp_start() moves on to the next AP.
+     The interrupt lock, which intr_init_ap() took, keeps the
+     scheduler from using this CPU until it is ready. */
+  cpu_cnt++;
+#ifdef USERPROG
+  gdt_init_ap ();
+  fpu_init ();
+#endif
+  lapic_init_ap ();
+  thread_start_ap ();
+}
+
+/* Local APIC timer interrupt handler, for the timer tick on the
+   APs. */
+static void
+timer_interrupt (struct intr_frame *args UNUSED)
+{
+  thread_tick ();
+}
+
+/* Reschedule IPI handler.  The idle loop that the IPI woke up
+   does the rest. */
+static void
+reschedule_interrupt (struct intr_frame *args UNUSED)
+{
+}
+
+/* Searches the places the MP spec says the floating pointer
+   structure may be, in order: the first kilobyte of the
+   extended BIOS data area, the last kilobyte of base memory,
+   and the BIOS ROM. */
+static struct mp_float *
+find_float (void)
+{
+  uintptr_t ebda = *(uint16_t *) ptov (0x40e) << 4;
+  uintptr_t base_kb = *(uint16_t *) ptov (0x413);
+  struct mp_float *mpf = NULL;
+
+  if (ebda != 0)
+    mpf = search (ebda, 1024);
+  if (mpf == NULL && base_kb != 0)
+    mpf = search (base_kb * 1024 - 1024, 1024);
+  if (mpf == NULL)
+    mpf = search (0xf0000, 0x10000);
+  return mpf;
+}
+
+/* Searches SIZE bytes of physical memory starting at PADDR for a
+   valid MP floating pointer structure. */
+static struct mp_float *
+search (uintptr_t paddr, size_t size)
+{
+  uint8_t *p = ptov (paddr);
+  uint8_t *end = p + size;
+
+  for (; p + sizeof (struct mp_float) <= end; p += 16)
+    if (!memcmp (p, "_MP_", 4) && checksum_ok (p, sizeof (struct mp_float)))
+      return (struct mp_float *) p;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes at P sum to 0 mod 256. */
+static bool
+checksum_ok (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
+/* Records the processors and APICs in configuration table CFG. */
+static void
+parse_config (const struct mp_config *cfg)
+{
+  const uint8_t *entry;
+  int i;
+
+  if (memcmp (cfg->signature, "PCMP", 4)
+      || !checksum_ok (cfg, cfg->length))
+    return;
+
+  lapic_paddr = cfg->lapic_paddr;
+  found_cnt = 0;
+  entry = (const uint8_t *) (cfg + 1);
+  for (i = 0; i < cfg->entry_cnt; i++)
+    {
+      if (*entry == MP_PROCESSOR)
+        {
+          const struct mp_processor *proc = (const void *) entry;
+          if ((proc->flags & MP_CPU_ENABLED) && found_cnt < MP_CPU_MAX)
+            found_lapic_ids[found_cnt++] = proc->lapic_id;
+          entry += sizeof *proc;
+        }
+      else if (*entry == MP_IOAPIC)
+        {
+          const struct mp_ioapic *ioapic = (const void *) entry;
+          if (ioapic_cnt++ == 0)
+            ioapic_paddr = ioapic->paddr;
+          entry += sizeof *ioapic;
+        }
+      else if (*entry <= MP_LINTR)
+        entry += 8;
+      else
+        break;
+    }
+  if (found_cnt == 0)
+    found_cnt = 1;
+}
@@ -0,0 +1,14 @@
+#ifndef THREADS_MP_H
+#define THREADS_MP_H
+
+/* Maximum number of CPUs that Pintos runs on. */
+#define MP_CPU_MAX 8
+
+void mp_init (void);
+void mp_start (void);
+int mp_cpu_cnt (void);
+int mp_cpu_id (void);
+void mp_send_reschedule (int cpu);
+void mp_print_config (void);
+
+#endif /* threads/mp.h */
@@ -29,8 +29,20 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/ktimer.h"
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/* Maximum length of a chain of nested priority donations. */
+#define DONATION_DEPTH_MAX 8
+
+static heap_less_func thread_priority_less;
+static heap_less_func semaphore_elem_less;
+static ktimer_func sema_timeout_expire;
+static void lock_donate (struct lock *);
+static void lock_take (struct lock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -47,7 +59,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, thread_priority_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -68,13 +80,106 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      struct thread *cur = thread_current ();
+
+      heap_insert (&sema->waiters, &cur->wait_elem);
+      if (cur->wait_queue == NULL)
+        {
+          cur->wait_queue = &sema->waiters;
+          cur->wait_queue_elem = &cur->wait_elem;
+        }
       thread_block ();
     }
   sema->value--;
   intr_set_level (old_level);
 }
 
+/* A thread waiting in sema_down_timeout(). */
+struct sema_timeout
+  {
+    struct semaphore *sema;     /* Semaphore waited on. */
+    struct thread *thread;      /* Waiting thread. */
+    bool expired;               /* Has the timeout passed? */
+  };
+
+/* Down or "P" operation on a semaphore, giving up if SEMA's
+   value does not become positive within TICKS timer ticks.
+   Returns true if the semaphore is decremented, false if the
+   wait timed out.  If TICKS is 0 or less, this is the same as
+   sema_try_down().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler.  This function may be called with
+   interrupts disabled, but if it sleeps then the next scheduled
+   thread will probably turn interrupts back on. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (sema->value == 0 && ticks > 0)
+    {
+      struct thread *cur = thread_current ();
+      struct sema_timeout timeout;
+      struct ktimer timer;
+
+      timeout.sema = sema;
+      timeout.thread = cur;
+      timeout.expired = false;
+      ktimer_init (&timer, sema_timeout_expire, &timeout);
+      ktimer_add (&timer, timer_ticks () + ticks);
+
+      while (sema->value == 0 && !timeout.expired)
+        {
+          heap_insert (&sema->waiters, &cur->wait_elem);
+          if (cur->wait_queue == NULL)
+            {
+              cur->wait_queue = &sema->waiters;
+              cur->wait_queue_elem = &cur->wait_elem;
+            }
+          thread_block ();
+        }
+      ktimer_cancel (&timer);
+    }
+
+  success = sema->value > 0;
+  if (success)
+    sema->value--;
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Timer function for sema_down_timeout().  If the thread is
+   still waiting, takes it off the semaphore's wait queue and
+   wakes it up. */
+static void
+sema_timeout_expire (void *timeout_)
+{
+  struct sema_timeout *timeout = timeout_;
+  struct thread *t = timeout->thread;
+
+  timeout->expired = true;
+
+  /* A waiter that sema_up() has already woken is no longer
+     blocked, and its wait_elem is no longer in the queue. */
+  if (t->status == THREAD_BLOCKED)
+    {
+      struct heap *waiters = &timeout->sema->waiters;
+
+      heap_remove (waiters, &t->wait_elem);
+      if (t->wait_queue == waiters)
+        t->wait_queue = NULL;
+      thread_unblock (t);
+      thread_check_preemption ();
+    }
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -102,7 +207,10 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any, taking waiters of equal priority in the order
+   they arrived.  If the thread woken up has a higher priority
+   than the running thread, the running thread yields to it.
 
    This function may be called from an interrupt handler. */
 void
@@ -113,11 +221,17 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+  if (!heap_empty (&sema->waiters)) 
+    {
+      struct thread *t = heap_entry (heap_pop (&sema->waiters),
+                                     struct thread, wait_elem);
+      if (t->wait_queue == &sema->waiters)
+        t->wait_queue = NULL;
+      thread_unblock (t);
+    }
   sema->value++;
   intr_set_level (old_level);
+  thread_check_preemption ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -179,12 +293,19 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->priority = PRI_MIN;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If the lock is held by a lower-priority thread, the current
+   thread donates its priority to the holder, and on down the
+   chain of locks the holder is itself waiting for, so that the
+   holder is not starved by medium-priority threads while we
+   wait.  The donation is withdrawn in lock_release().
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +313,91 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  lock_donate (lock);
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock_take (lock);
+  intr_set_level (old_level);
+}
+
+/* Acquires LOCK, like lock_acquire(), but gives up if LOCK does
+   not become available within TICKS timer ticks.  Returns true
+   if successful, false if the wait timed out.
+
+   On a timeout, the priority we donated to LOCK's holder is
+   withdrawn.  Any donation passed on further down a chain of
+   nested locks lasts until those locks are released.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  old_level = intr_disable ();
+  lock_donate (lock);
+  success = sema_down_timeout (&lock->semaphore, ticks);
+  cur->waiting_lock = NULL;
+  if (success)
+    lock_take (lock);
+  else if (lock->holder != NULL && !thread_mlfqs)
+    {
+      struct heap *waiters = &lock->semaphore.waiters;
+
+      lock->priority = PRI_MIN;
+      if (!heap_empty (waiters))
+        lock->priority = heap_entry (heap_top (waiters),
+                                     struct thread, wait_elem)->priority;
+      thread_update_priority (lock->holder);
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* If LOCK is held by a lower-priority thread, donates the
+   current thread's priority to the holder, and on down the chain
+   of locks the holder is itself waiting for.  Interrupts must be
+   off. */
+static void
+lock_donate (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+  struct lock *l = lock;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (lock->holder == NULL || thread_mlfqs)
+    return;
+
+  cur->waiting_lock = lock;
+  trace_event (TRACE_LOCK_WAIT, cur->tid, (uint32_t) lock,
+               lock->holder->tid);
+  for (depth = 0; l != NULL && l->holder != NULL
+         && depth < DONATION_DEPTH_MAX; depth++)
+    {
+      if (cur->priority <= l->priority)
+        break;
+      l->priority = cur->priority;
+      thread_update_priority (l->holder);
+      l = l->holder->waiting_lock;
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,10 +416,36 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock_take (lock);
+      intr_set_level (old_level);
+    }
   return success;
 }
 
+/* Makes the current thread the holder of LOCK, which it has just
+   acquired.  Any threads still waiting for LOCK keep donating
+   their priority through it.  Interrupts must be off. */
+static void
+lock_take (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+  struct heap *waiters = &lock->semaphore.waiters;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  trace_event (TRACE_LOCK_ACQUIRE, cur->tid, (uint32_t) lock, 0);
+  lock->holder = cur;
+  lock->priority = PRI_MIN;
+  if (!heap_empty (waiters))
+    lock->priority = heap_entry (heap_top (waiters),
+                                 struct thread, wait_elem)->priority;
+  list_push_back (&cur->held_locks, &lock->elem);
+  if (!thread_mlfqs)
+    thread_update_priority (cur);
+}
+
 /* Releases LOCK, which must be owned by the current thread.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -228,10 +454,21 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  /* Withdraw the priority donated through LOCK. */
+  old_level = intr_disable ();
+  trace_event (TRACE_LOCK_RELEASE, thread_current ()->tid, (uint32_t) lock, 0);
+  list_remove (&lock->elem);
   lock->holder = NULL;
+  lock->priority = PRI_MIN;
+  if (!thread_mlfqs)
+    thread_update_priority (thread_current ());
+  intr_set_level (old_level);
+
   sema_up (&lock->semaphore);
 }
 
@@ -246,11 +483,12 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's wait queue. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on semaphore. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -261,7 +499,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, semaphore_elem_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -288,6 +526,7 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -295,15 +534,25 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  waiter.thread = thread_current ();
+
+  /* Our priority orders COND's queue, not WAITER's semaphore,
+     which nobody else waits on. */
+  old_level = intr_disable ();
+  heap_insert (&cond->waiters, &waiter.elem);
+  waiter.thread->wait_queue = &cond->waiters;
+  waiter.thread->wait_queue_elem = &waiter.elem;
+  intr_set_level (old_level);
+
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one of them to wake
+   up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -316,9 +565,16 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  if (!heap_empty (&cond->waiters)) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct semaphore_elem *waiter
+        = heap_entry (heap_pop (&cond->waiters), struct semaphore_elem, elem);
+      waiter->thread->wait_queue = NULL;
+      intr_set_level (old_level);
+
+      sema_up (&waiter->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -333,6 +589,318 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as a readers-writer lock that nobody holds.
+
+   Readers pass through RW's gate lock on the way in, so a thread
+   that holds or waits for write access keeps new readers out
+   until it is done, and writers cannot starve behind a stream of
+   overlapping readers.  Because the gate is an ordinary lock,
+   threads blocked behind a writer donate their priority to it
+   and are let in highest priority first.
+
+   Priority is not donated to readers: a writer waiting for the
+   current readers to finish only holds back new arrivals, so
+   read-side critical sections should be kept short. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->gate);
+  rw->readers = 0;
+  rw->writer_waiting = false;
+  sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   is waiting for it.  The current thread must not already hold
+   RW for writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->gate);
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->gate);
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns
+   true if successful, false if a writer holds or is waiting for
+   RW. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  if (!lock_try_acquire (&rw->gate))
+    return false;
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->gate);
+  return true;
+}
+
+/* Drops one reader from RW and wakes the waiting writer if that
+   was the last one. */
+static void
+rwlock_drop_reader (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->writer_waiting)
+    {
+      rw->writer_waiting = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases read access to RW, which the current thread must
+   hold. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  rwlock_drop_reader (rw);
+}
+
+/* Waits until every reader has left RW.  The current thread must
+   hold RW's gate, which keeps new readers from arriving. */
+static void
+rwlock_wait_for_readers (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&rw->gate));
+
+  old_level = intr_disable ();
+  if (rw->readers > 0)
+    {
+      rw->writer_waiting = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it in either mode.  New readers are held off from the moment
+   the writer starts waiting.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->gate);
+  rwlock_wait_for_readers (rw);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns
+   true if successful, false if any other thread holds RW. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  if (!lock_try_acquire (&rw->gate))
+    return false;
+  if (rw->readers > 0)
+    {
+      lock_release (&rw->gate);
+      return false;
+    }
+  return true;
+}
+
+/* Releases write access to RW, which the current thread must
+   hold.  The highest-priority thread waiting for RW, reader or
+   writer, goes next. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_release (&rw->gate);
+}
+
+/* Converts the current thread's read access to RW into write
+   access, waiting for any other readers to leave.  Returns true
+   if successful.  Fails, keeping read access, if another writer
+   already holds the gate: that writer is itself waiting for this
+   thread to stop reading, so the caller must release RW and
+   acquire it again for writing. */
+bool
+rwlock_try_upgrade (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rw->readers > 0);
+
+  if (!lock_try_acquire (&rw->gate))
+    return false;
+  rwlock_drop_reader (rw);
+  rwlock_wait_for_readers (rw);
+  return true;
+}
+
+/* Converts the current thread's write access to RW into read
+   access.  No writer can get in between, and readers waiting
+   behind the current thread are let in. */
+void
+rwlock_downgrade (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->gate);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->gate) && rw->readers == 0;
+}
+
+/* Initializes spinlock LOCK.  A spinlock provides mutual
+   exclusion between CPUs for short critical sections that never
+   sleep, such as the page allocator's bitmap updates.  A thread
+   waiting for a spinlock spins instead of blocking.
+
+   Code that runs with interrupts off already excludes every
+   other such critical section on every CPU, through the
+   interrupt lock that intr_disable() takes (see interrupt.c), so
+   it needs no spinlock.  A spinlock serves code that would
+   otherwise need that lock, to let critical sections on
+   different data run on different CPUs at once.  A spinlock
+   holder must not call intr_disable() or anything that might
+   sleep, and should hold no other spinlock. */
+void
+spinlock_init (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  lock->locked = 0;
+  lock->intr_on = false;
+}
+
+/* Acquires LOCK, spinning until it is free.  Interrupts are
+   turned off on the local CPU, without taking the interrupt
+   lock, until spinlock_release(), so that an interrupt handler
+   cannot run or switch threads while LOCK is held.
+
+   This function may be called within an interrupt handler. */
+void
+spinlock_acquire (struct spinlock *lock)
+{
+  bool intr_on = intr_get_level () == INTR_ON;
+
+  asm volatile ("cli" : : : "memory");
+  spinlock_lock (lock);
+  lock->intr_on = intr_on;
+}
+
+/* Releases LOCK, which the running thread must hold, and turns
+   interrupts back on if they were on at spinlock_acquire(). */
+void
+spinlock_release (struct spinlock *lock)
+{
+  bool intr_on = lock->intr_on;
+
+  spinlock_unlock (lock);
+  if (intr_on)
+    asm volatile ("sti" : : : "memory");
+}
+
+/* Spins until LOCK is free, then takes it, without changing
+   the interrupt level.  Spinning reads LOCK without writing it,
+   so that waiting CPUs do not fight over its cache line, and
+   uses PAUSE to go easy on the CPU that holds it.  For the
+   interrupt lock; other code should use spinlock_acquire(). */
+void
+spinlock_lock (struct spinlock *lock)
+{
+  int was_locked;
+
+  ASSERT (lock != NULL);
+
+  for (;;)
+    {
+      asm volatile ("xchgl %0, %1"
+                    : "=r" (was_locked), "+m" (lock->locked)
+                    : "0" (1) : "memory");
+      if (!was_locked)
+        break;
+      while (lock->locked)
+        asm volatile ("pause");
+    }
+}
+
+/* Releases LOCK, which must be held, without changing the
+   interrupt level. */
+void
+spinlock_unlock (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (lock->locked);
+
+  barrier ();
+  lock->locked = 0;
+}
+
+/* Returns true if thread A has lower priority than thread B,
+   false otherwise. */
+static bool
+thread_priority_less (const struct heap_elem *a_,
+                      const struct heap_elem *b_, void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+  return a->priority < b->priority;
+}
+
+/* Returns true if the thread waiting on semaphore_elem A has
+   lower priority than the thread waiting on semaphore_elem B,
+   false otherwise. */
+static bool
+semaphore_elem_less (const struct heap_elem *a_,
+                     const struct heap_elem *b_, void *aux UNUSED)
+{
+  const struct semaphore_elem *a
+    = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = heap_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority < b->thread->priority;
+}
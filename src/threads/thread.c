@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -7,10 +8,13 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,16 +24,91 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue: processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running.  Each CPU has
+   its own run queue, along with the rest of its scheduling
+   state.  A thread that becomes ready joins the run queue of the
+   CPU that readied it, and a CPU whose run queue is empty steals
+   a thread from the CPU with the most (see steal_thread()).
+
+   Run queues are protected by turning interrupts off, like the
+   rest of the scheduler's state.  Once more than one CPU is
+   running, that also takes the interrupt lock (see
+   interrupt.c), so a CPU may look at and change any CPU's run
+   queue.
+
+   There is one FIFO list per priority level, and bit P of
+   ready_mask is set if and only if ready_queues[P] is nonempty,
+   so that the highest-priority ready thread can be found in
+   constant time regardless of how many threads are ready.
+
+   The earliest-deadline-first run queue, edf_queue, holds ready
+   threads of the EDF scheduling class, ordered by absolute
+   deadline.  These always run before any thread in
+   ready_queues.  A thread is in the EDF class while it has run
+   time left in its current job (edf_budget > 0).  A job that
+   uses up its budget is demoted to the priority run queues until
+   the thread calls thread_edf_yield() to start its next job, so
+   that an overrunning EDF thread cannot starve the rest of the
+   system.
+
+   The completely fair scheduler (CFS) run queue, cfs_tree, is
+   used instead of ready_queues when thread_cfs is true.  Each
+   thread accumulates virtual run time (vruntime) as it runs, at
+   a rate inversely proportional to its weight, which follows
+   from its nice value.  The ready thread with the least vruntime
+   runs next, so over time each thread receives CPU time in
+   proportion to its weight.  Ready threads are kept in a
+   red-black tree ordered by vruntime, so that picking the next
+   thread takes O(lg n) time. */
+struct runqueue
+  {
+    struct list ready_queues[PRI_MAX + 1];
+    uint64_t ready_mask;
+    int ready_cnt;              /* Total number of ready threads. */
+
+    struct list edf_queue;      /* Ready EDF threads. */
+
+    struct rb_tree cfs_tree;    /* Ready CFS threads. */
+    int64_t cfs_min_vruntime;   /* Monotonic lower bound on vruntime. */
+    long long cfs_weight;       /* Sum of weights of threads in cfs_tree. */
+
+    struct thread *idle;        /* This CPU's idle thread. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+    bool kicked;                /* Sent a reschedule IPI since scheduling? */
+
+    /* True while the running thread is being preempted, so that
+       schedule() can count the switch as involuntary.  schedule()
+       clears it before switching threads. */
+    bool preempting;
+  };
+
+/* Run queues, indexed by CPU. */
+static struct runqueue runqueues[MP_CPU_MAX];
+
+/* Sum of the densities (run time divided by relative deadline)
+   of all EDF threads.  Admission control keeps this at or below
+   1.0, which guarantees that EDF can meet every deadline. */
+static fixed_point edf_density;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Cache of pages freed by exiting threads.  thread_create()
+   reuses these before asking palloc for a new page.  A cached
+   page is not zeroed: init_thread() initializes `struct thread'
+   and the kernel stack needs no initialization, so clearing the
+   whole page would be wasted work.  In debug builds the stack
+   part is filled with 0xcc, as palloc_free_page() would do, so
+   that use of a dead thread's stack still stands out.  When the
+   kernel pool runs out, palloc gives the cached pages back to
+   the pool with thread_cache_shrink(). */
+#define THREAD_CACHE_SIZE 16
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static int thread_cache_cnt;
+static long long thread_cache_hits;     /* # of pages reused. */
+static long long thread_cache_misses;   /* # of pages from palloc. */
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -49,34 +128,101 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long steal_cnt;     /* # of threads taken from another CPU. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.  Controlled by
+   kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* CFS parameters. */
+#define CFS_LATENCY 12          /* Ticks in which every ready thread runs. */
+#define CFS_MIN_SLICE 1         /* Minimum time slice, in ticks. */
+#define CFS_TICK_VRUNTIME 1024  /* vruntime for 1 tick at nice 0. */
+#define CFS_NICE_0_WEIGHT 1024  /* Weight of a thread at nice 0. */
+
+/* Weight of a thread for each nice value, from NICE_MIN to
+   NICE_MAX.  Each step in nice changes a thread's CPU share
+   relative to a thread at the neighbouring nice value by about
+   10%, since each weight is about 1.25 times the next. */
+static const int cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    88761, 71755, 56483, 46273, 36291,  /* -20 ... -16 */
+    29154, 23254, 18705, 14949, 11916,  /* -15 ... -11 */
+     9548,  7620,  6100,  4904,  3906,  /* -10 ...  -6 */
+     3121,  2501,  1991,  1586,  1277,  /*  -5 ...  -1 */
+     1024,   820,   655,   526,   423,  /*   0 ...   4 */
+      335,   272,   215,   172,   137,  /*   5 ...   9 */
+      110,    87,    70,    56,    45,  /*  10 ...  14 */
+       36,    29,    23,    18,    15,  /*  15 ...  19 */
+       12,                              /*  20 */
+  };
+
+/* MLFQS state. */
+#define PRIORITY_INTERVAL 4     /* # of ticks between priority updates. */
+static fixed_point load_avg;    /* System load average. */
+
+/* Threads whose recent_cpu has changed since their priority was
+   last computed.  Only these need a new priority every
+   PRIORITY_INTERVAL ticks; every other thread's priority is
+   still up to date. */
+static struct list recent_cpu_list;
+
+/* MLFQS statistics. */
+static long long mlfqs_updates; /* # of priorities recomputed. */
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
-static struct thread *next_thread_to_run (void);
+static struct runqueue *cpu_rq (void);
+static bool is_idle (const struct thread *);
+static void init_runqueue (struct runqueue *);
+static struct thread *next_thread_to_run (struct runqueue *);
+static struct thread *steal_thread (struct runqueue *);
+static void kick_idle_cpu (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_push (struct runqueue *, struct thread *);
+static struct thread *ready_pop (struct runqueue *);
+static int ready_max_priority (const struct runqueue *);
+static void ready_set_priority (struct thread *, int priority);
+static bool ready_preempts (struct thread *);
+static struct thread *edf_pop (struct runqueue *);
+static list_less_func edf_deadline_less;
+static fixed_point edf_thread_density (const struct thread *);
+static rb_less_func cfs_vruntime_less;
+static int cfs_thread_weight (const struct thread *);
+static unsigned cfs_slice (const struct runqueue *, const struct thread *);
+static void cfs_update_min_vruntime (struct runqueue *,
+                                     const struct thread *);
+static void set_status (struct thread *, enum thread_status);
+static void print_thread_stats (struct thread *, void *aux);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_mark_recent_cpu (struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, void *aux);
+static void mlfqs_update_priority (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the bootstrap processor's run queue and the
+   tid lock.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -90,8 +236,9 @@ thread_init (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  init_runqueue (&runqueues[0]);
   list_init (&all_list);
+  list_init (&recent_cpu_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -101,7 +248,7 @@ thread_init (void)
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
-   Also creates the idle thread. */
+   Also creates the bootstrap processor's idle thread. */
 void
 thread_start (void) 
 {
@@ -113,19 +260,60 @@ thread_start (void)
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to initialize runqueues[0].idle. */
   sema_down (&idle_started);
 }
 
+/* Creates the idle thread for application processor CPU, which
+   mp.c is about to start, and initializes CPU's run queue.  The
+   CPU starts out running the idle thread, on whose stack it
+   calls thread_start_ap(), so the thread is created in the
+   running state instead of being put in a run queue. */
+struct thread *
+thread_create_idle (int cpu)
+{
+  struct runqueue *rq = &runqueues[cpu];
+  struct thread *t;
+
+  ASSERT (cpu > 0 && cpu < MP_CPU_MAX);
+
+  t = alloc_thread_page ();
+  if (t == NULL)
+    PANIC ("thread_create_idle: out of pages");
+  init_thread (t, "idle", PRI_MIN);
+  t->tid = allocate_tid ();
+  t->cpu = cpu;
+  t->status = THREAD_RUNNING;
+
+  init_runqueue (rq);
+  rq->idle = t;
+  return t;
+}
+
+/* Runs the idle thread of the application processor that calls
+   it, which thread_create_idle() created.  Called by mp.c, with
+   interrupts off, once the CPU is ready to run threads. */
+void
+thread_start_ap (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_idle (thread_current ()));
+
+  idle (NULL);
+  NOT_REACHED ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) 
 {
   struct thread *t = thread_current ();
+  struct runqueue *rq = &runqueues[t->cpu];
 
   /* Update statistics. */
-  if (t == idle_thread)
+  t->stats.run_ticks++;
+  if (is_idle (t))
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
@@ -134,17 +322,122 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
+  /* Charge EDF threads for their run time.  A thread whose job
+     has used up its budget drops out of the EDF class. */
+  if (t->edf_budget > 0 && --t->edf_budget == 0)
+    intr_yield_on_return ();
+
+  /* Charge CFS threads for their run time, weighted by their
+     nice values. */
+  if (thread_cfs && !is_idle (t))
+    {
+      t->vruntime += (CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT
+                      / cfs_thread_weight (t));
+      cfs_update_min_vruntime (rq, t);
+    }
+
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++rq->thread_ticks >= (thread_cfs ? cfs_slice (rq, t) : TIME_SLICE))
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics, including scheduling statistics
+   for each thread that still exists. */
 void
 thread_print_stats (void) 
 {
+  enum intr_level old_level;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  if (thread_mlfqs)
+    {
+      long long total_ticks = idle_ticks + kernel_ticks + user_ticks;
+      long long per_tick_x100 = (total_ticks > 0
+                                 ? mlfqs_updates * 100 / total_ticks : 0);
+      printf ("Thread: %lld MLFQS priority updates, %lld.%02lld per tick\n",
+              mlfqs_updates, per_tick_x100 / 100, per_tick_x100 % 100);
+    }
+  printf ("Thread: %lld pages reused from cache, %lld allocated\n",
+          thread_cache_hits, thread_cache_misses);
+  if (mp_cpu_cnt () > 1)
+    printf ("Thread: %lld threads stolen between %d CPUs\n",
+            steal_cnt, mp_cpu_cnt ());
+
+  old_level = intr_disable ();
+  thread_foreach (print_thread_stats, NULL);
+  intr_set_level (old_level);
+}
+
+/* Prints scheduling statistics for thread T.  This is a
+   thread_action_func. */
+static void
+print_thread_stats (struct thread *t, void *aux UNUSED)
+{
+  const struct thread_stats *s = &t->stats;
+
+  printf ("Thread %d (%s): %lld run, %lld ready, %lld blocked ticks, "
+          "%"PRIu32" voluntary, %"PRIu32" involuntary switches, "
+          "last CPU %d\n",
+          t->tid, t->name, s->run_ticks, s->ready_ticks, s->blocked_ticks,
+          s->voluntary_switches, s->involuntary_switches, s->last_cpu);
+  if (t->edf_period != 0)
+    printf ("Thread %d (%s): EDF period %d, run time %d, deadline %d, "
+            "%"PRIu32" jobs, %"PRIu32" missed deadlines\n",
+            t->tid, t->name, t->edf_period, t->edf_runtime, t->edf_deadline,
+            s->edf_jobs, s->edf_misses);
+}
+
+/* Copies the scheduling statistics of the thread with the given
+   TID into *STATS.  Returns true if successful, false if there
+   is no such thread. */
+bool
+thread_get_stats (tid_t tid, struct thread_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = get_thread (tid);
+  bool success = t != NULL;
+
+  if (success)
+    {
+      *stats = t->stats;
+
+      /* Bring the time in T's current state up to date. */
+      if (t->status == THREAD_READY)
+        stats->ready_ticks += timer_ticks () - t->status_tick;
+      else if (t->status == THREAD_BLOCKED)
+        stats->blocked_ticks += timer_ticks () - t->status_tick;
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Accounts for TICKS timer ticks that the idle thread spent
+   halted without any timer interrupt, under tickless idle. */
+void
+thread_idle_ticks (int64_t ticks)
+{
+  idle_ticks += ticks;
+}
+
+/* Returns the number of threads in the run queues, not counting
+   the running threads or the idle threads. */
+int
+thread_ready_count (void)
+{
+  enum intr_level old_level = intr_disable ();
+  int ready_cnt = 0;
+  int i;
+
+  for (i = 0; i < mp_cpu_cnt (); i++)
+    ready_cnt += runqueues[i].ready_cnt;
+  intr_set_level (old_level);
+
+  return ready_cnt;
 }
 
 /* 
@@ -177,9 +470,8 @@ get_thread(tid_t tid){
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, the running thread yields to it immediately. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -193,7 +485,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -218,6 +510,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_check_preemption ();
 
   return tid;
 }
@@ -234,7 +527,8 @@ thread_block (void)
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  trace_event (TRACE_BLOCK, thread_current ()->tid, 0, 0);
+  set_status (thread_current (), THREAD_BLOCKED);
   schedule ();
 }
 
@@ -242,6 +536,9 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
+   T joins the running CPU's run queue.  If another CPU is idle,
+   it is interrupted so that it can take T from there.
+
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
@@ -249,14 +546,29 @@ thread_block (void)
 void
 thread_unblock (struct thread *t) 
 {
+  struct runqueue *rq;
   enum intr_level old_level;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
-  t->status = THREAD_READY;
+  rq = cpu_rq ();
+
+  /* A thread that has slept for a long time gets some credit
+     for it, but not so much that it can monopolize the CPU. */
+  if (thread_cfs)
+    {
+      int64_t min_vruntime = (rq->cfs_min_vruntime
+                              - CFS_LATENCY * CFS_TICK_VRUNTIME / 2);
+      if (t->vruntime < min_vruntime)
+        t->vruntime = min_vruntime;
+    }
+
+  ready_push (rq, t);
+  set_status (t, THREAD_READY);
+  trace_event (TRACE_WAKEUP, running_thread ()->tid, t->tid, t->priority);
+  kick_idle_cpu ();
   intr_set_level (old_level);
 }
 
@@ -308,8 +620,11 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  edf_density -= edf_thread_density (thread_current ());
   list_remove (&thread_current()->allelem);
-  thread_current ()->status = THREAD_DYING;
+  if (thread_current ()->recent_cpu_changed)
+    list_remove (&thread_current ()->recent_elem);
+  set_status (thread_current (), THREAD_DYING);
   schedule ();
   NOT_REACHED ();
 }
@@ -325,13 +640,45 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
-  cur->status = THREAD_READY;
+  if (!is_idle (cur)) 
+    ready_push (cpu_rq (), cur);
+  set_status (cur, THREAD_READY);
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Like thread_yield(), but for when the running thread is being
+   preempted, by the end of its time slice or by a
+   higher-priority thread, rather than giving up the CPU of its
+   own accord.  The only difference is in the statistics. */
+void
+thread_preempt (void)
+{
+  enum intr_level old_level = intr_disable ();
+  cpu_rq ()->preempting = true;
+  thread_yield ();
+  intr_set_level (old_level);
+}
+
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  In an external interrupt handler, the
+   yield is deferred until the interrupt returns. */
+void
+thread_check_preemption (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool preempt = ready_preempts (thread_current ());
+  intr_set_level (old_level);
+
+  if (preempt)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_preempt ();
+    }
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -349,11 +696,134 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.
+   Priority donated to the thread through locks it holds still
+   applies.  Yields if the running thread no longer has the
+   highest priority.  Ignored under the MLFQS, which computes
+   priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  thread_current ()->base_priority = new_priority;
+  thread_update_priority (thread_current ());
+  intr_set_level (old_level);
+  thread_check_preemption ();
+}
+
+/* Makes the running thread a periodic thread of the EDF
+   scheduling class, which runs before every thread scheduled by
+   priority.  Every PERIOD ticks, the thread may run for RUNTIME
+   ticks, and each such job must complete within DEADLINE ticks
+   of the start of its period.  The first job starts now.
+
+   Returns false, leaving the thread's scheduling unchanged, if
+   the parameters do not satisfy 0 < RUNTIME <= DEADLINE <=
+   PERIOD, or if admitting the thread would make the EDF threads'
+   total density exceed 1, so that some deadlines could be
+   missed. */
+bool
+thread_set_edf (int period, int runtime, int deadline)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  fixed_point density;
+  bool success = false;
+
+  if (runtime <= 0 || runtime > deadline || deadline > period)
+    return false;
+  density = fp_div (fp_from_int (runtime), fp_from_int (deadline));
+
+  old_level = intr_disable ();
+  if (edf_density - edf_thread_density (cur) + density <= FP_ONE)
+    {
+      edf_density += density - edf_thread_density (cur);
+      cur->edf_period = period;
+      cur->edf_runtime = runtime;
+      cur->edf_deadline = deadline;
+      cur->edf_budget = runtime;
+      cur->edf_release = timer_ticks ();
+      cur->edf_abs_deadline = cur->edf_release + deadline;
+      success = true;
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Returns the running thread to scheduling by priority. */
+void
+thread_clear_edf (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  edf_density -= edf_thread_density (cur);
+  cur->edf_period = cur->edf_runtime = cur->edf_deadline = 0;
+  cur->edf_budget = 0;
+  intr_set_level (old_level);
+  thread_check_preemption ();
+}
+
+/* Completes the running EDF thread's current job and sleeps
+   until its next period begins, when its next job starts with a
+   fresh budget.  A job that completes after its deadline counts
+   as a missed deadline. */
+void
+thread_edf_yield (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now;
+
+  ASSERT (cur->edf_period != 0);
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  cur->stats.edf_jobs++;
+  if (now > cur->edf_abs_deadline)
+    cur->stats.edf_misses++;
+
+  /* A job that overran its whole period delays the next one,
+     rather than leaving it with a deadline already past. */
+  cur->edf_release += cur->edf_period;
+  if (cur->edf_release < now)
+    cur->edf_release = now;
+  cur->edf_abs_deadline = cur->edf_release + cur->edf_deadline;
+  cur->edf_budget = cur->edf_runtime;
+  intr_set_level (old_level);
+
+  timer_sleep_until (cur->edf_release);
+}
+
+/* Recomputes T's priority as the larger of its base priority and
+   the priorities donated through the locks it holds, moving T to
+   its new run queue if it is ready.  Interrupts must be off. */
+void
+thread_update_priority (struct thread *t)
+{
+  int priority = t->base_priority;
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (is_thread (t));
+
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct lock *lock = list_entry (e, struct lock, elem);
+      if (lock->priority > priority)
+        priority = lock->priority;
+    }
+  ready_set_priority (t, priority);
 }
 
 /* Returns the current thread's priority. */
@@ -363,52 +833,174 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  thread_current ()->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (thread_current ());
+  intr_set_level (old_level);
+  thread_check_preemption ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_x100 = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load_avg_x100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_x100 = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu_x100;
+}
+
+/* Updates MLFQS state for timer tick, with T as the running
+   thread.  Called in interrupt context.
+
+   Every tick, T's recent_cpu grows.  Once per second, load_avg
+   is recomputed and every thread's recent_cpu decays, which is
+   the only time all threads have to be visited.  Every
+   PRIORITY_INTERVAL ticks, priorities are recomputed, but only
+   for the threads on recent_cpu_list, since no other thread's
+   priority can have changed.  Only the bootstrap processor,
+   whose timer advances timer_ticks(), does the once-per-second
+   and every-PRIORITY_INTERVAL work, for all CPUs. */
+static void
+mlfqs_tick (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  if (!is_idle (t))
+    {
+      t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+      mlfqs_mark_recent_cpu (t);
+    }
+
+  if (t->cpu != 0)
+    return;
+
+  if (now % TIMER_FREQ == 0)
+    {
+      int ready_threads = 0;
+      int i;
+
+      for (i = 0; i < mp_cpu_cnt (); i++)
+        {
+          struct runqueue *rq = &runqueues[i];
+          ready_threads += rq->ready_cnt;
+          if (rq->idle == NULL || rq->idle->status != THREAD_RUNNING)
+            ready_threads++;
+        }
+      load_avg = (load_avg * 59 + fp_from_int (ready_threads)) / 60;
+      thread_foreach (mlfqs_update_recent_cpu, NULL);
+    }
+
+  if (now % PRIORITY_INTERVAL == 0)
+    {
+      while (!list_empty (&recent_cpu_list))
+        {
+          struct thread *u = list_entry (list_pop_front (&recent_cpu_list),
+                                         struct thread, recent_elem);
+          u->recent_cpu_changed = false;
+          mlfqs_update_priority (u);
+        }
+      thread_check_preemption ();
+    }
+}
+
+/* Adds T to recent_cpu_list, if it is not already there. */
+static void
+mlfqs_mark_recent_cpu (struct thread *t)
+{
+  if (!t->recent_cpu_changed)
+    {
+      t->recent_cpu_changed = true;
+      list_push_back (&recent_cpu_list, &t->recent_elem);
+    }
+}
+
+/* Decays T's recent_cpu according to load_avg.  A thread with
+   no recent_cpu and zero niceness is left alone, since its
+   recent_cpu would not change.  This is a thread_action_func. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *aux UNUSED)
+{
+  fixed_point twice_load, coefficient;
+
+  if (is_idle (t) || (t->recent_cpu == 0 && t->nice == 0))
+    return;
+
+  twice_load = load_avg * 2;
+  coefficient = fp_div (twice_load, fp_add_int (twice_load, 1));
+  t->recent_cpu = fp_add_int (fp_mul (coefficient, t->recent_cpu), t->nice);
+  mlfqs_mark_recent_cpu (t);
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values.
+   Interrupts must be off. */
+static void
+mlfqs_update_priority (struct thread *t)
+{
+  int priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+
+  if (!is_idle (t))
+    ready_set_priority (t, priority);
+  mlfqs_updates++;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
-
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   Each CPU has one.
+
+   The bootstrap processor's idle thread is initially put on the
+   ready list by thread_start().  It will be scheduled once
+   initially, at which point it initializes runqueues[0].idle,
+   "up"s the semaphore passed to it to enable thread_start() to
+   continue, and immediately blocks.  Other CPUs' idle threads
+   are started by thread_start_ap(), with a null IDLE_STARTED.
+   After that, an idle thread never appears in a ready list.  It
+   is returned by next_thread_to_run() as a special case when
+   its CPU has no thread to run. */
 static void
-idle (void *idle_started_ UNUSED) 
+idle (void *idle_started_) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
-  sema_up (idle_started);
+
+  if (idle_started != NULL)
+    {
+      cpu_rq ()->idle = thread_current ();
+      sema_up (idle_started);
+    }
 
   for (;;) 
     {
@@ -416,19 +1008,12 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
-      /* Re-enable interrupts and wait for the next one.
-
-         The `sti' instruction disables interrupts until the
-         completion of the next instruction, so these two
-         instructions are executed atomically.  This atomicity is
-         important; otherwise, an interrupt could be handled
-         between re-enabling interrupts and waiting for the next
-         one to occur, wasting as much as one clock tick worth of
-         time.
+      /* Under tickless idle, stop the periodic timer interrupt
+         until there is something for it to do. */
+      timer_idle_enter ();
 
-         See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-      asm volatile ("sti; hlt" : : : "memory");
+      /* Re-enable interrupts and wait for the next one. */
+      intr_wait ();
     }
 }
 
@@ -457,6 +1042,33 @@ running_thread (void)
   return pg_round_down (esp);
 }
 
+/* Returns the running CPU's run queue.  Interrupts should be
+   off, so that the running thread cannot move to another CPU. */
+static struct runqueue *
+cpu_rq (void)
+{
+  return &runqueues[running_thread ()->cpu];
+}
+
+/* Returns true if T is the idle thread of its CPU. */
+static bool
+is_idle (const struct thread *t)
+{
+  return t == runqueues[t->cpu].idle;
+}
+
+/* Initializes RQ as an empty run queue. */
+static void
+init_runqueue (struct runqueue *rq)
+{
+  int i;
+
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&rq->ready_queues[i]);
+  list_init (&rq->edf_queue);
+  rb_init (&rq->cfs_tree, cfs_vruntime_less, NULL);
+}
+
 /* Returns true if T appears to point to a valid thread. */
 static bool
 is_thread (struct thread *t)
@@ -477,11 +1089,28 @@ init_thread (struct thread *t, const char *name, int priority)
 
   memset (t, 0, sizeof *t);
   t->status = THREAD_BLOCKED;
+  t->status_tick = timer_ticks ();
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->vruntime = cpu_rq ()->cfs_min_vruntime;
+  list_init (&t->held_locks);
   t->magic = THREAD_MAGIC;
 
+  /* Under the MLFQS, a new thread inherits its parent's nice and
+     recent_cpu values, and its priority follows from those. */
+  if (t != running_thread ())
+    {
+      t->nice = running_thread ()->nice;
+      t->recent_cpu = running_thread ()->recent_cpu;
+    }
+  if (thread_mlfqs)
+    {
+      old_level = intr_disable ();
+      mlfqs_update_priority (t);
+      intr_set_level (old_level);
+    }
+
   #ifdef USERPROG
     t->parent = running_thread();
     sema_init(&t->process_sema, 0);
@@ -510,18 +1139,299 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+/* Returns the index of the most significant set bit in MASK,
+   which must be nonzero.  Uses the BSR instruction (via
+   __builtin_clz) on each 32-bit half, so it takes constant
+   time. */
+static inline int
+highest_bit (uint64_t mask)
+{
+  uint32_t hi = mask >> 32;
+
+  ASSERT (mask != 0);
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else
+    return 31 - __builtin_clz ((uint32_t) mask);
+}
+
+/* Adds T to RQ's EDF run queue if it is in the EDF class,
+   otherwise to the back of RQ's run queue for its priority.
+   Interrupts must be off. */
+static void
+ready_push (struct runqueue *rq, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  if (t->edf_budget > 0)
+    list_insert_ordered (&rq->edf_queue, &t->elem, edf_deadline_less, NULL);
+  else if (thread_cfs)
+    {
+      rb_insert (&rq->cfs_tree, &t->cfs_elem);
+      rq->cfs_weight += cfs_thread_weight (t);
+    }
+  else
+    {
+      list_push_back (&rq->ready_queues[t->priority], &t->elem);
+      rq->ready_mask |= (uint64_t) 1 << t->priority;
+    }
+  rq->ready_cnt++;
+  t->cpu = rq - runqueues;
+}
+
+/* Removes and returns the thread at the front of the
+   highest-priority nonempty run queue in RQ, which must exist,
+   or under the CFS, RQ's ready thread with the least vruntime.
+   Does not consider the EDF run queue.  Interrupts must be
+   off. */
 static struct thread *
-next_thread_to_run (void) 
+ready_pop (struct runqueue *rq)
+{
+  struct thread *t;
+
+  if (thread_cfs)
+    {
+      t = rb_entry (rb_min (&rq->cfs_tree), struct thread, cfs_elem);
+      rb_remove (&rq->cfs_tree, &t->cfs_elem);
+      rq->cfs_weight -= cfs_thread_weight (t);
+      cfs_update_min_vruntime (rq, t);
+    }
+  else
+    {
+      int priority = highest_bit (rq->ready_mask);
+      struct list *queue = &rq->ready_queues[priority];
+
+      t = list_entry (list_pop_front (queue), struct thread, elem);
+      if (list_empty (queue))
+        rq->ready_mask &= ~((uint64_t) 1 << priority);
+    }
+  rq->ready_cnt--;
+  return t;
+}
+
+/* Sets T's priority to PRIORITY.  If T is in one of the
+   priority run queues, moves it to the back of the run queue
+   for its new priority.  If T is blocked in a wait queue, which
+   is ordered by priority, re-keys it there.  Interrupts must be
+   off. */
+static void
+ready_set_priority (struct thread *t, int priority)
+{
+  struct runqueue *rq = &runqueues[t->cpu];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status == THREAD_READY && t->edf_budget == 0 && !thread_cfs
+      && t->priority != priority)
+    {
+      list_remove (&t->elem);
+      if (list_empty (&rq->ready_queues[t->priority]))
+        rq->ready_mask &= ~((uint64_t) 1 << t->priority);
+      rq->ready_cnt--;
+      t->priority = priority;
+      ready_push (rq, t);
+
+      /* A thread on its way into cond_wait() may be preempted
+         after joining the condition's queue. */
+      if (t->wait_queue != NULL)
+        heap_update (t->wait_queue, t->wait_queue_elem);
+    }
+  else if (t->priority != priority)
+    {
+      t->priority = priority;
+      if (t->wait_queue != NULL)
+        heap_update (t->wait_queue, t->wait_queue_elem);
+    }
+}
+
+/* Returns the priority of the highest-priority ready thread in
+   RQ, or -1 if no thread is ready.  Interrupts must be off. */
+static int
+ready_max_priority (const struct runqueue *rq)
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
+  return rq->ready_mask != 0 ? highest_bit (rq->ready_mask) : -1;
+}
+
+/* Returns true if some thread ready on T's CPU should run
+   instead of T, the running thread.  Interrupts must be off. */
+static bool
+ready_preempts (struct thread *t)
+{
+  struct runqueue *rq = &runqueues[t->cpu];
+
+  if (is_idle (t))
+    return rq->ready_cnt > 0;
+  else if (!list_empty (&rq->edf_queue))
+    return (t->edf_budget == 0
+            || edf_deadline_less (list_front (&rq->edf_queue), &t->elem,
+                                  NULL));
+  else if (t->edf_budget > 0)
+    return false;
+  else if (thread_cfs)
+    return (!rb_empty (&rq->cfs_tree)
+            && (rb_entry (rb_min (&rq->cfs_tree),
+                          struct thread, cfs_elem)->vruntime
+                + CFS_TICK_VRUNTIME < t->vruntime));
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return ready_max_priority (rq) > t->priority;
+}
+
+/* Removes and returns the thread with the earliest deadline in
+   RQ's EDF run queue, which must not be empty.  Interrupts must
+   be off. */
+static struct thread *
+edf_pop (struct runqueue *rq)
+{
+  rq->ready_cnt--;
+  return list_entry (list_pop_front (&rq->edf_queue), struct thread, elem);
+}
+
+/* Returns true if thread A's current job has an earlier
+   deadline than thread B's. */
+static bool
+edf_deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+                   void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->edf_abs_deadline < b->edf_abs_deadline;
+}
+
+/* Returns true if thread A has less vruntime than thread B. */
+static bool
+cfs_vruntime_less (const struct rb_elem *a_, const struct rb_elem *b_,
+                   void *aux UNUSED)
+{
+  const struct thread *a = rb_entry (a_, struct thread, cfs_elem);
+  const struct thread *b = rb_entry (b_, struct thread, cfs_elem);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Returns T's CFS weight. */
+static int
+cfs_thread_weight (const struct thread *t)
+{
+  return cfs_weights[t->nice - NICE_MIN];
+}
+
+/* Returns the length of the time slice for running thread T
+   under the CFS: T's share, by weight, of CFS_LATENCY ticks, so
+   that the more threads are ready in RQ, T's run queue, the
+   shorter the slices. */
+static unsigned
+cfs_slice (const struct runqueue *rq, const struct thread *t)
+{
+  int weight = cfs_thread_weight (t);
+  int slice = CFS_LATENCY * weight / (rq->cfs_weight + weight);
+
+  return slice > CFS_MIN_SLICE ? slice : CFS_MIN_SLICE;
+}
+
+/* Advances RQ's cfs_min_vruntime to the least vruntime of T,
+   which is running or about to run on RQ's CPU, and the threads
+   in RQ's CFS run queue.  cfs_min_vruntime never decreases. */
+static void
+cfs_update_min_vruntime (struct runqueue *rq, const struct thread *t)
+{
+  int64_t min_vruntime = t->vruntime;
+
+  if (!rb_empty (&rq->cfs_tree))
+    {
+      struct thread *first = rb_entry (rb_min (&rq->cfs_tree),
+                                       struct thread, cfs_elem);
+      if (first->vruntime < min_vruntime)
+        min_vruntime = first->vruntime;
+    }
+  if (min_vruntime > rq->cfs_min_vruntime)
+    rq->cfs_min_vruntime = min_vruntime;
+}
+
+/* Returns the density of EDF thread T, or 0 if T is not an EDF
+   thread. */
+static fixed_point
+edf_thread_density (const struct thread *t)
+{
+  if (t->edf_period == 0)
+    return 0;
+  return fp_div (fp_from_int (t->edf_runtime), fp_from_int (t->edf_deadline));
+}
+
+/* Chooses and returns the next thread to be scheduled on RQ's
+   CPU.  Should return a thread from RQ, unless RQ is empty.  (If
+   the running thread can continue running, then it will be in
+   RQ.)  If RQ is empty, tries to steal a thread from another
+   CPU, and failing that, returns RQ's idle thread.
+
+   Threads in the EDF class always run first, in order of
+   deadline. */
+static struct thread *
+next_thread_to_run (struct runqueue *rq) 
+{
+  rq->kicked = false;
+  if (!list_empty (&rq->edf_queue))
+    return edf_pop (rq);
+  else if (rq->ready_cnt == 0)
+    return steal_thread (rq);
+  else
+    return ready_pop (rq);
+}
+
+/* Takes the thread that would run next on the CPU with the most
+   ready threads, for RQ's CPU, which has none, and returns it.
+   Returns RQ's idle thread if no CPU has a thread to spare.
+
+   The thread's vruntime is moved by the difference between the
+   two run queues' minimum vruntimes, so that it keeps its place
+   relative to the threads it left behind. */
+static struct thread *
+steal_thread (struct runqueue *rq)
+{
+  struct runqueue *victim = NULL;
+  struct thread *t;
+  int i;
+
+  for (i = 0; i < mp_cpu_cnt (); i++)
+    if (runqueues[i].ready_cnt > 0
+        && (victim == NULL || runqueues[i].ready_cnt > victim->ready_cnt))
+      victim = &runqueues[i];
+  if (victim == NULL)
+    return rq->idle;
+
+  if (!list_empty (&victim->edf_queue))
+    t = edf_pop (victim);
+  else
+    t = ready_pop (victim);
+  t->vruntime += rq->cfs_min_vruntime - victim->cfs_min_vruntime;
+  t->cpu = rq - runqueues;
+  steal_cnt++;
+  return t;
+}
+
+/* Sends a reschedule IPI to one idle CPU other than the running
+   one, if there is one, so that it will take a thread from the
+   running CPU's run queue.  A CPU is sent at most one such IPI
+   between times that it schedules.  Interrupts must be off. */
+static void
+kick_idle_cpu (void)
+{
+  int self = running_thread ()->cpu;
+  int i;
+
+  for (i = 0; i < mp_cpu_cnt (); i++)
+    {
+      struct runqueue *rq = &runqueues[i];
+
+      if (i != self && !rq->kicked
+          && rq->idle != NULL && rq->idle->status == THREAD_RUNNING)
+        {
+          rq->kicked = true;
+          mp_send_reschedule (i);
+          return;
+        }
+    }
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -548,10 +1458,11 @@ thread_schedule_tail (struct thread *prev)
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Mark us as running. */
-  cur->status = THREAD_RUNNING;
+  set_status (cur, THREAD_RUNNING);
+  cur->stats.last_cpu = cur->cpu;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  runqueues[cur->cpu].thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -566,10 +1477,79 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      free_thread_page (prev);
     }
 }
 
+/* Returns a page for a new thread, taken from the thread page
+   cache if possible, or a null pointer if no memory is
+   available.  The page's contents are arbitrary. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    {
+      t = thread_cache[--thread_cache_cnt];
+      thread_cache_hits++;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        thread_cache_misses++;
+    }
+  return t;
+}
+
+/* Frees T's page, the page of a thread that has exited, keeping
+   it in the thread page cache if there is room.  Interrupts must
+   be off. */
+static void
+free_thread_page (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Make a stale pointer to T fail is_thread(). */
+  t->magic = 0;
+
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    {
+#ifndef NDEBUG
+      memset ((uint8_t *) t + sizeof *t, 0xcc, PGSIZE - sizeof *t);
+#endif
+      thread_cache[thread_cache_cnt++] = t;
+    }
+  else
+    palloc_free_page (t);
+}
+
+/* Returns every page in the thread page cache to the page
+   allocator, and returns the number of pages freed.  Called by
+   palloc_get_multiple() when the kernel pool is exhausted. */
+size_t
+thread_cache_shrink (void)
+{
+  struct thread *pages[THREAD_CACHE_SIZE];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = thread_cache_cnt;
+  memcpy (pages, thread_cache, cnt * sizeof *pages);
+  thread_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    palloc_free_page (pages[i]);
+  return cnt;
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -581,18 +1561,45 @@ static void
 schedule (void) 
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct runqueue *rq = &runqueues[cur->cpu];
+  struct thread *next = next_thread_to_run (rq);
   struct thread *prev = NULL;
+  bool involuntary = rq->preempting;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  /* Clear the flag before switching, so that it does not apply
+     to the next thread's switch away. */
+  rq->preempting = false;
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      if (involuntary)
+        cur->stats.involuntary_switches++;
+      else
+        cur->stats.voluntary_switches++;
+      trace_event (TRACE_SWITCH, cur->tid, next->tid, cur->status);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
+/* Sets T's status to STATUS, charging the time T spent in its
+   previous status to T's statistics. */
+static void
+set_status (struct thread *t, enum thread_status status)
+{
+  int64_t now = timer_ticks ();
+
+  if (t->status == THREAD_READY)
+    t->stats.ready_ticks += now - t->status_tick;
+  else if (t->status == THREAD_BLOCKED)
+    t->stats.blocked_ticks += now - t->status_tick;
+  t->status = status;
+  t->status_tick = now;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
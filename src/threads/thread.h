@@ -2,9 +2,16 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <rbtree.h>
+#include <stats.h>
 #include <stdint.h>
 #include <threads/synch.h>
+#include "threads/fixed-point.h"
+#ifdef USERPROG
+#include "userprog/fpu.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -25,6 +32,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, used by the MLFQS and the CFS. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
 #define MAX_CHILDREN 85             /* Maximum number of children a thread can have */ 
 
 /* A kernel thread or user process.
@@ -79,10 +91,12 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the sleep list (timer.c).  It
+   can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep list, and a sleeping thread
+   is not waiting on any semaphore. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -90,11 +104,43 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
     struct list_elem allelem;           /* List element for all threads list. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    int base_priority;                  /* Priority without donations. */
+    struct list held_locks;             /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being waited for, if any. */
+    struct heap_elem wait_elem;         /* Element in semaphore's waiters. */
+    struct heap *wait_queue;            /* Wait queue ordered by priority. */
+    struct heap_elem *wait_queue_elem;  /* Our element in wait_queue. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, if sleeping. */
+
+    /* Owned by thread.c, used only by the MLFQS. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recent CPU time received. */
+    bool recent_cpu_changed;            /* In recent_cpu_list? */
+    struct list_elem recent_elem;       /* Element in recent_cpu_list. */
+
+    /* Owned by thread.c, used only by the CFS. */
+    int64_t vruntime;                   /* Run time weighted by nice. */
+    struct rb_elem cfs_elem;            /* Element in CFS run queue. */
+
+    /* Owned by thread.c, used only by EDF threads. */
+    int edf_period;                     /* Period in ticks, 0 if not EDF. */
+    int edf_runtime;                    /* Run time per period, in ticks. */
+    int edf_deadline;                   /* Deadline relative to release. */
+    int edf_budget;                     /* Run time left in current job. */
+    int64_t edf_release;                /* Current job's release tick. */
+    int64_t edf_abs_deadline;           /* Current job's deadline tick. */
+
+    /* Owned by thread.c. */
+    int cpu;                            /* CPU running or queuing thread. */
+    struct thread_stats stats;          /* Scheduling statistics. */
+    int64_t status_tick;                /* Tick of last status change. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -106,6 +152,10 @@ struct thread
     tid_t child_process_list[MAX_CHILDREN];      /* Array of child processes */
     int exit_status[MAX_CHILDREN];               /* Exit status of the child threada */
     char *malloced_pointers[30];       /*A list of pointer we need to free when the thread exits*/
+
+    /* Owned by userprog/fpu.c. */
+    uint8_t fpu_state[FPU_STATE_SIZE];  /* x87 state saved by FNSAVE. */
+    bool fpu_used;                      /* Has the process used the FPU? */
 #endif
 
     /* Owned by thread.c. */
@@ -117,16 +167,27 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which ignores
+   priorities.  Controlled by kernel command-line option
+   "-cfs". */
+extern bool thread_cfs;
+
 struct thread* get_thread(tid_t tid);
 
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (int cpu);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
 void thread_print_stats (void);
+bool thread_get_stats (tid_t, struct thread_stats *);
+void thread_idle_ticks (int64_t ticks);
+int thread_ready_count (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+size_t thread_cache_shrink (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -137,6 +198,8 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
+void thread_check_preemption (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -144,6 +207,11 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *);
+
+bool thread_set_edf (int period, int runtime, int deadline);
+void thread_clear_edf (void);
+void thread_edf_yield (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
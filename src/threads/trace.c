@@ -0,0 +1,155 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Number of records in the ring buffer.  Must be a power of 2. */
+#define TRACE_CNT 4096
+
+/* Pages in the ring buffer. */
+#define TRACE_PAGES (TRACE_CNT * sizeof (struct trace_record) / PGSIZE)
+
+/* Start tracing at boot?  Set by the -trace kernel option. */
+bool trace_boot;
+
+/* Record events?  Tested inline at every trace point. */
+bool trace_enabled;
+
+/* Ring buffer, allocated by the first trace_start(). */
+static struct trace_record *records;
+
+/* Number of records ever written.  The next record goes in slot
+   RECORD_CNT % TRACE_CNT. */
+static uint32_t record_cnt;
+
+/* Time-stamp counter and timer ticks when tracing first started,
+   used to convert time-stamp counter values to time. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static void dump_thread (struct thread *, void *aux);
+
+/* Starts tracing if the -trace option was given.  Must be called
+   after the page allocator is initialized. */
+void
+trace_init (void)
+{
+  if (trace_boot && !trace_start ())
+    printf ("trace: no memory for trace buffer, tracing disabled\n");
+}
+
+/* Starts recording events, allocating the trace buffer if
+   necessary.  Returns true if successful, false if the buffer
+   could not be allocated. */
+bool
+trace_start (void)
+{
+  if (records == NULL)
+    {
+      records = palloc_get_multiple (PAL_ZERO, TRACE_PAGES);
+      if (records == NULL)
+        return false;
+      start_tsc = timer_cycles ();
+      start_ticks = timer_ticks ();
+    }
+  trace_enabled = true;
+  return true;
+}
+
+/* Stops recording events.  The records already in the buffer are
+   kept. */
+void
+trace_stop (void)
+{
+  trace_enabled = false;
+}
+
+/* Appends a record to the trace buffer.  Use trace_event(), which
+   checks trace_enabled first, instead of calling this
+   directly. */
+void
+trace_record (enum trace_type type, tid_t tid, uint32_t arg, uint32_t arg2)
+{
+  enum intr_level old_level = intr_disable ();
+  struct trace_record *r = &records[record_cnt++ % TRACE_CNT];
+
+  r->tsc = timer_cycles ();
+  r->type = type;
+  r->tid = tid;
+  r->arg = arg;
+  r->arg2 = arg2;
+  intr_set_level (old_level);
+}
+
+/* Returns the number of records in the trace buffer. */
+size_t
+trace_size (void)
+{
+  return record_cnt < TRACE_CNT ? record_cnt : TRACE_CNT;
+}
+
+/* Copies record IDX of the trace buffer, counting from the
+   oldest, into *R.  IDX must be less than trace_size(). */
+void
+trace_get (size_t idx, struct trace_record *r)
+{
+  enum intr_level old_level;
+
+  ASSERT (idx < trace_size ());
+
+  old_level = intr_disable ();
+  *r = records[(record_cnt - trace_size () + idx) % TRACE_CNT];
+  intr_set_level (old_level);
+}
+
+/* Prints the trace buffer to the console, oldest record first,
+   in the format that utils/trace-decode reads.  Tracing is
+   suspended while the dump is printed, so that the dump does not
+   trace its own console output. */
+void
+trace_dump (void)
+{
+  bool was_enabled = trace_enabled;
+  uint64_t cycles_per_tick;
+  int64_t ticks;
+  enum intr_level old_level;
+  size_t i;
+
+  if (records == NULL)
+    return;
+
+  trace_enabled = false;
+  ticks = timer_ticks () - start_ticks;
+  cycles_per_tick = ticks > 0 ? (timer_cycles () - start_tsc) / ticks : 0;
+
+  printf ("trace: begin %zu records, %"PRIu32" lost, "
+          "%llu cycles per tick, %d ticks per second\n",
+          trace_size (), record_cnt - trace_size (),
+          cycles_per_tick, TIMER_FREQ);
+  old_level = intr_disable ();
+  thread_foreach (dump_thread, NULL);
+  intr_set_level (old_level);
+  for (i = 0; i < trace_size (); i++)
+    {
+      struct trace_record r;
+
+      trace_get (i, &r);
+      printf ("trace: %016llx %"PRIu32" %d %"PRIx32" %"PRIx32"\n",
+              r.tsc, r.type, r.tid, r.arg, r.arg2);
+    }
+  printf ("trace: end\n");
+
+  trace_enabled = was_enabled;
+}
+
+/* Prints T's tid and name, so that the decoder can name the
+   threads in the trace. */
+static void
+dump_thread (struct thread *t, void *aux UNUSED)
+{
+  printf ("trace: thread %d %s\n", t->tid, t->name);
+}
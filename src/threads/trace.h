@@ -0,0 +1,68 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Scheduler event trace.
+
+   When tracing is on, the scheduler, the synchronization
+   primitives, and the timer interrupt record what they do in a
+   fixed-size ring buffer, overwriting the oldest records once it
+   fills.  Recording is safe from interrupt handlers.  The buffer
+   is dumped to the console by trace_dump(), which shutdown does
+   automatically, and utils/trace-decode turns a dump into a
+   timeline.
+
+   Tracing is off unless the kernel is booted with -trace or some
+   code calls trace_start().  While it is off, each trace point
+   costs a single test of trace_enabled. */
+
+/* Event types.  utils/trace-decode knows these by number, so add
+   new types only at the end. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* Switch; ARG next tid, ARG2 status. */
+    TRACE_WAKEUP,               /* Unblock; ARG is tid woken. */
+    TRACE_BLOCK,                /* Thread blocks. */
+    TRACE_LOCK_WAIT,            /* Lock busy; ARG is lock, ARG2 holder. */
+    TRACE_LOCK_ACQUIRE,         /* Lock acquired; ARG is lock. */
+    TRACE_LOCK_RELEASE,         /* Lock released; ARG is lock. */
+    TRACE_TICK,                 /* Timer interrupt; ARG is tick. */
+    TRACE_TYPE_CNT
+  };
+
+/* One trace record. */
+struct trace_record
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint32_t type;              /* A TRACE_* value. */
+    tid_t tid;                  /* Thread that caused the event. */
+    uint32_t arg;               /* Event-specific. */
+    uint32_t arg2;              /* Event-specific. */
+  };
+
+extern bool trace_boot;
+extern bool trace_enabled;
+
+void trace_init (void);
+bool trace_start (void);
+void trace_stop (void);
+void trace_dump (void);
+size_t trace_size (void);
+void trace_get (size_t, struct trace_record *);
+
+void trace_record (enum trace_type, tid_t, uint32_t arg, uint32_t arg2);
+
+/* Records an event of the given TYPE, caused by thread TID, if
+   tracing is on. */
+static inline void
+trace_event (enum trace_type type, tid_t tid, uint32_t arg, uint32_t arg2)
+{
+  if (trace_enabled)
+    trace_record (type, tid, arg, arg2);
+}
+
+#endif /* threads/trace.h */
@@ -0,0 +1,165 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Queue of pending work items, in FIFO order.  Items are linked
+   through their `next' members, so queuing an item needs no
+   memory allocation.  On our single CPU, turning interrupts off
+   for the few instructions that link or unlink an item is all
+   the synchronization the queue needs, so it can be used from
+   interrupt handlers without any lock. */
+static struct work *queue_head;
+static struct work *queue_tail;
+
+/* Number of items in the queue.  Worker threads wait on it. */
+static struct semaphore queue_cnt;
+
+/* Statistics. */
+static long long work_cnt;      /* # of work items run. */
+static int depth;               /* Current queue depth. */
+static int max_depth;           /* Greatest queue depth. */
+static uint64_t total_latency;  /* Sum of deferral latencies, in cycles. */
+static uint64_t max_latency;    /* Greatest deferral latency, in cycles. */
+
+static thread_func worker;
+static void push (struct work *);
+
+/* Initializes the work queue.  Work items may be queued
+   afterward, but they will not run until workqueue_start() has
+   been called. */
+void
+workqueue_init (void)
+{
+  queue_head = queue_tail = NULL;
+  sema_init (&queue_cnt, 0);
+}
+
+/* Starts the worker threads.  Must be called after
+   thread_start(). */
+void
+workqueue_start (void)
+{
+  int i;
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_MAX, worker, NULL);
+    }
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void)
+{
+  printf ("Workqueue: %lld items run, max depth %d, "
+          "latency avg %llu max %llu cycles\n",
+          work_cnt, max_depth,
+          work_cnt > 0 ? total_latency / work_cnt : 0, max_latency);
+}
+
+/* Initializes W as a work item that runs FUNC, passing AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->next = NULL;
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+  w->running = false;
+}
+
+/* Queues W to be run by a worker thread.  Returns true if W was
+   queued, false if it was already pending.  Never blocks, so it
+   may be called from an interrupt handler. */
+bool
+work_queue (struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = true;
+      w->queue_tsc = timer_cycles ();
+
+      /* If W is running, the worker running it will queue it
+         again when it finishes. */
+      if (!w->running)
+        push (w);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Adds W to the back of the queue and wakes a worker.
+   Interrupts must be off. */
+static void
+push (struct work *w)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  w->next = NULL;
+  if (queue_tail != NULL)
+    queue_tail->next = w;
+  else
+    queue_head = w;
+  queue_tail = w;
+
+  if (++depth > max_depth)
+    max_depth = depth;
+  sema_up (&queue_cnt);
+}
+
+/* Worker thread.  Runs queued work items, one at a time. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      uint64_t latency;
+      struct work *w;
+
+      sema_down (&queue_cnt);
+
+      old_level = intr_disable ();
+      w = queue_head;
+      queue_head = w->next;
+      if (queue_head == NULL)
+        queue_tail = NULL;
+      depth--;
+
+      w->pending = false;
+      w->running = true;
+      latency = timer_cycles () - w->queue_tsc;
+      total_latency += latency;
+      if (latency > max_latency)
+        max_latency = latency;
+      work_cnt++;
+      intr_set_level (old_level);
+
+      w->func (w->aux);
+
+      old_level = intr_disable ();
+      w->running = false;
+      if (w->pending)
+        push (w);
+      intr_set_level (old_level);
+    }
+}
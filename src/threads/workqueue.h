@@ -0,0 +1,46 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deferred work.
+
+   An external interrupt handler runs with interrupts off, so
+   any time it spends delays every other interrupt, including
+   the timer's.  A handler can instead do only what must happen
+   immediately, such as acknowledging the device and reading its
+   data registers, and queue a work item for the rest.  A work
+   item's function runs later in one of a small pool of
+   high-priority worker threads, with interrupts on, and may
+   block.
+
+   work_queue() may be called from an interrupt handler or a
+   kernel thread, with interrupts on or off.  It never blocks.
+   Queuing a work item that is already queued has no effect, so
+   a handler may queue the same item on every interrupt, and its
+   function should process everything that has accumulated.  A
+   work item never runs in two worker threads at once. */
+
+/* Function run by a work item, given auxiliary data AUX. */
+typedef void work_func (void *aux);
+
+/* A work item. */
+struct work
+  {
+    struct work *next;          /* Next item in the queue. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Queued but not yet started? */
+    bool running;               /* FUNC is running now? */
+    uint64_t queue_tsc;         /* Time-stamp counter when queued. */
+  };
+
+void workqueue_init (void);
+void workqueue_start (void);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+
+#endif /* threads/workqueue.h */
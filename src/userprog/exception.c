@@ -1,6 +1,7 @@
 #include "userprog/exception.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include "userprog/fpu.h"
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -10,6 +11,7 @@
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void device_not_available (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -46,8 +48,6 @@ exception_init (void)
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
   intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
-                     "#NM Device Not Available Exception");
   intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
   intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
   intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -59,6 +59,12 @@ exception_init (void)
      We need to disable interrupts for page faults because the
      fault address is stored in CR2 and needs to be preserved. */
   intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
+
+  /* #NM is how a process's first FPU instruction since a context
+     switch gets its FPU state loaded; see fpu.c.  Interrupts
+     stay off so that the FPU cannot change hands meanwhile. */
+  intr_register_int (7, 0, INTR_OFF, device_not_available,
+                     "#NM Device Not Available Exception");
 }
 
 /* Prints exception statistics. */
@@ -109,6 +115,18 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Device-not-available (#NM) handler.  A user process executed
+   an FPU instruction with CR0.TS set, so it needs its FPU state
+   loaded before the instruction is restarted.  The kernel never
+   uses the FPU, so #NM from kernel code is a bug. */
+static void
+device_not_available (struct intr_frame *f)
+{
+  if (f->cs != SEL_UCSEG)
+    kill (f);
+  fpu_load ();
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -0,0 +1,160 @@
+#include "userprog/fpu.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/mp.h"
+#include "threads/thread.h"
+
+/* Lazy switching of the x87 FPU between user processes.
+
+   The kernel itself never uses the FPU (it is compiled with
+   -msoft-float), so the FPU registers only ever hold the state
+   of one user process, fpu_owner.  A context switch does not
+   save or restore that state.  Instead, switching to any thread
+   other than the owner sets CR0.TS, so that the thread's first
+   FPU instruction raises #NM (device not available).  The #NM
+   handler calls fpu_load(), which saves the owner's state into
+   the owner's struct thread, loads the current thread's, and
+   makes it the new owner.  Processes that never use the FPU
+   never pay for saving or restoring it.
+
+   Each CPU has its own FPU and so its own owner.  With more than
+   one CPU running, a thread's state must not stay behind in one
+   CPU's FPU while the thread runs on another, so a CPU saves its
+   owner's state as soon as it switches to any other thread, and
+   only the loading stays lazy.
+
+   Only the x87 state is switched.  Saving SSE state as well
+   would need FXSAVE and a 512-byte, 16-byte-aligned save area,
+   and user programs built with -march=i686 do not use SSE. */
+
+/* CR0 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR0_MP 0x00000002       /* Monitor coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task switched. */
+#define CR0_NE 0x00000020       /* Numeric error reporting. */
+
+/* Thread whose state is in each CPU's FPU registers, or a null
+   pointer. */
+static struct thread *fpu_owner[MP_CPU_MAX];
+
+/* True if CR0.TS is set on each CPU. */
+static bool ts_set[MP_CPU_MAX];
+
+/* Statistics. */
+static long long fpu_load_cnt;  /* # of FPU states loaded. */
+
+static inline uint32_t
+read_cr0 (void)
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+static inline void
+write_cr0 (uint32_t cr0)
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+}
+
+/* Enables the FPU for user processes.  The loader turned on
+   CR0.EM, which makes every FPU instruction fault; turn it off,
+   and turn on CR0.TS so that the first FPU instruction still
+   faults, into fpu_load().  CR0.MP makes WAIT/FWAIT fault too,
+   and CR0.NE reports FPU errors as #MF exceptions. */
+void
+fpu_init (void)
+{
+  write_cr0 ((read_cr0 () & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+  ts_set[mp_cpu_id ()] = true;
+}
+
+/* Sets CR0.TS unless the running thread owns the FPU.  Called
+   on every context switch.  With more than one CPU running,
+   first saves the state of any other owner. */
+void
+fpu_activate (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *cur = thread_current ();
+  int cpu = mp_cpu_id ();
+  bool set;
+
+  if (mp_cpu_cnt () > 1 && fpu_owner[cpu] != NULL && fpu_owner[cpu] != cur)
+    {
+      asm volatile ("clts");
+      asm volatile ("fnsave (%0)"
+                    : : "r" (fpu_owner[cpu]->fpu_state) : "memory");
+      fpu_owner[cpu] = NULL;
+      ts_set[cpu] = false;
+    }
+
+  set = cur != fpu_owner[cpu];
+  if (set != ts_set[cpu])
+    {
+      if (set)
+        write_cr0 (read_cr0 () | CR0_TS);
+      else
+        asm volatile ("clts");
+      ts_set[cpu] = set;
+    }
+  intr_set_level (old_level);
+}
+
+/* Gives the FPU to the running thread, saving the previous
+   owner's state and loading the running thread's, or a freshly
+   initialized state if it has not used the FPU before.  Called
+   by the #NM handler, with interrupts off. */
+void
+fpu_load (void)
+{
+  struct thread *cur = thread_current ();
+  int cpu;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cpu = mp_cpu_id ();
+  asm volatile ("clts");
+  ts_set[cpu] = false;
+  if (fpu_owner[cpu] == cur)
+    return;
+
+  if (fpu_owner[cpu] != NULL)
+    asm volatile ("fnsave (%0)"
+                  : : "r" (fpu_owner[cpu]->fpu_state) : "memory");
+  if (cur->fpu_used)
+    asm volatile ("frstor (%0)" : : "r" (cur->fpu_state) : "memory");
+  else
+    {
+      asm volatile ("fninit");
+      cur->fpu_used = true;
+    }
+  fpu_owner[cpu] = cur;
+  fpu_load_cnt++;
+}
+
+/* Discards the FPU state of T, which is exiting. */
+void
+fpu_release (struct thread *t)
+{
+  enum intr_level old_level = intr_disable ();
+  int cpu = mp_cpu_id ();
+
+  if (fpu_owner[cpu] == t)
+    {
+      fpu_owner[cpu] = NULL;
+      fpu_activate ();
+    }
+  t->fpu_used = false;
+  intr_set_level (old_level);
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void)
+{
+  printf ("FPU: %lld states loaded\n", fpu_load_cnt);
+}
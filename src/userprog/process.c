@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include "userprog/fpu.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -210,6 +211,7 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+  fpu_release (cur);
     
     int i = 0;
     while (i < 30 && thread_current ()->malloced_pointers[i] != NULL) 
@@ -246,6 +248,10 @@ process_activate (void)
   /* Set thread's kernel stack for use in processing
      interrupts. */
   tss_update ();
+
+  /* Make the thread's first FPU instruction trap, unless the
+     FPU already holds its state. */
+  fpu_activate ();
 }
 
 /* We load ELF binaries.  The following definitions are taken
@@ -1,10 +1,13 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
+#include "devices/block.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "pagedir.h"
@@ -416,5 +419,58 @@ syscall_handler (struct intr_frame *f UNUSED)
     
     f->eax = process_wait(args[0]);
   }
+  else if (syscall_number == SYS_SCHEDSTATS)
+  {
+    struct thread_stats stats;
+
+    //the whole struct must be in user memory
+    if (bad_ptr_arg(args[1]) || bad_ptr_arg(args[1] + sizeof stats - 1))
+    {
+      exit(-1);
+    }
+
+    //pid 0 means the calling process
+    tid_t tid = args[0] != 0 ? args[0] : thread_current ()->tid;
+    bool success = thread_get_stats (tid, &stats);
+    if (success)
+    {
+      memcpy((void *) args[1], &stats, sizeof stats);
+    }
+    f->eax = success;
+  }
+  else if (syscall_number == SYS_BLOCKSTATS)
+  {
+    struct block_stats stats;
+    struct block *block;
+    int i;
+
+    //the whole struct must be in user memory
+    if (bad_ptr_arg(args[1]) || bad_ptr_arg(args[1] + sizeof stats - 1))
+    {
+      exit(-1);
+    }
+
+    //devices are numbered from 0 in kernel probe order
+    block = args[0] >= 0 ? block_first () : NULL;
+    for (i = 0; block != NULL && i < args[0]; i++)
+      block = block_next (block);
+    if (block != NULL)
+    {
+      block_get_stats (block, &stats);
+      memcpy((void *) args[1], &stats, sizeof stats);
+    }
+    f->eax = block != NULL;
+  }
+  else if (syscall_number == SYS_CLOCK)
+  {
+    int64_t ns = timer_ns ();
+
+    //the whole value must be in user memory
+    if (bad_ptr_arg(args[0]) || bad_ptr_arg(args[0] + sizeof ns - 1))
+    {
+      exit(-1);
+    }
+    memcpy((void *) args[0], &ns, sizeof ns);
+  }
   // free(args);
 }
\ No newline at end of file